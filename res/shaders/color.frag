@@ -0,0 +1,11 @@
+#version 330 core
+in vec3 colour;
+out vec4 FragColor;
+uniform int isHit;
+void main()
+{
+    if (isHit == 1)
+        FragColor = vec4(1.0, 1.0, 1.0, 1.0);
+    else
+        FragColor = vec4(colour, 1.0f);
+}
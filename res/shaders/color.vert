@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColour;
+uniform vec3 offset;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+out vec3 colour;
+void main()
+{
+    gl_Position = projection*view*model*vec4(aPos + offset, 1.0);
+    colour = aColour;
+}
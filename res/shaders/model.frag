@@ -0,0 +1,14 @@
+#version 330 core
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+out vec4 FragColor;
+uniform int isHit;
+uniform sampler2D texture1;
+void main()
+{
+    if (isHit == 1)
+        FragColor = vec4(1.0, 1.0, 1.0, 1.0);
+    else
+        FragColor = texture(texture1, TexCoords);
+}
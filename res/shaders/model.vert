@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+layout (location = 2) in vec3 aNormal;
+uniform vec3 offset;
+uniform vec3 posScale;
+uniform vec3 posBias;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+out vec2 TexCoords;
+out vec3 Normal;
+out vec3 FragPos;
+void main()
+{
+FragPos = vec3(model * vec4(aPos * posScale + posBias + offset, 1.0));
+Normal = mat3(transpose(inverse(model))) * aNormal;
+TexCoords = aTexCoords;
+gl_Position = projection * view * vec4(FragPos, 1.0);
+}
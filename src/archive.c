@@ -0,0 +1,245 @@
+#include "archive.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5 // Последние байты блока - всегда литералы
+#define LZ4_MF_LIMIT 12     // Совпадение не начинается ближе к концу
+#define LZ4_HASH_BITS 16
+#define LZ4_MAX_OFFSET 65535
+
+_Static_assert(sizeof(ArchiveHeader) == 32, "ArchiveHeader layout is part of the .g3da format");
+_Static_assert(sizeof(ArchiveEntry) == 56, "ArchiveEntry layout is part of the .g3da format");
+
+uint64_t archiveHash(const char* name)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (; *name; name++)
+        h = (h ^ (unsigned char)*name) * 1099511628211ull;
+    return h;
+}
+
+int openArchiveMemory(const void* data, size_t size, Archive* archive)
+{
+    memset(archive, 0, sizeof(*archive));
+    const ArchiveHeader* h = data;
+    if (size < sizeof(ArchiveHeader))
+        return -1;
+    size_t tableBytes = (size_t)h->tableSize * sizeof(uint32_t);
+    size_t entryBytes = (size_t)h->numEntries * sizeof(ArchiveEntry);
+    int ok = memcmp(h->magic, ARCHIVE_MAGIC, 4) == 0 && h->version == ARCHIVE_VERSION &&
+             h->tableSize > 0 && (h->tableSize & (h->tableSize - 1)) == 0 && h->numEntries < h->tableSize &&
+             h->tocOffset <= size && h->tocSize <= size - h->tocOffset && entryBytes + tableBytes <= h->tocSize &&
+             h->tocOffset % 8 == 0;
+    const ArchiveEntry* entries = (const ArchiveEntry*)((const char*)data + (ok ? h->tocOffset : 0));
+    size_t namesSize = ok ? h->tocSize - entryBytes - tableBytes : 0;
+    for (uint32_t i = 0; ok && i < h->numEntries; i++) {
+        const ArchiveEntry* e = &entries[i];
+        ok = e->offset <= h->tocOffset && e->size <= h->tocOffset - e->offset &&
+             (uint64_t)e->nameOffset + e->nameLength < namesSize &&
+             (e->compression == ARCHIVE_STORED ? e->size == e->rawSize : e->compression == ARCHIVE_LZ4);
+    }
+    if (!ok)
+        return -1;
+    archive->map = (void*)data;
+    archive->mapSize = size;
+    archive->header = h;
+    archive->entries = entries;
+    archive->table = (const uint32_t*)(entries + h->numEntries);
+    archive->names = (const char*)(archive->table + h->tableSize);
+    return 0;
+}
+
+int openArchive(const char* path, Archive* archive)
+{
+    memset(archive, 0, sizeof(*archive));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ArchiveHeader)) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+    if (openArchiveMemory(map, (size_t)st.st_size, archive) != 0) {
+        printf("Invalid asset archive: %s\n", path);
+        munmap(map, st.st_size);
+        return -1;
+    }
+    archive->mapped = 1;
+    return 0;
+}
+
+void closeArchive(Archive* archive)
+{
+    if (archive->mapped)
+        munmap(archive->map, archive->mapSize);
+    memset(archive, 0, sizeof(*archive));
+}
+
+int archiveFind(const Archive* archive, const char* name)
+{
+    if (!archive->map)
+        return -1;
+    uint64_t hash = archiveHash(name);
+    size_t length = strlen(name);
+    uint32_t mask = archive->header->tableSize - 1;
+    uint32_t slot = (uint32_t)hash & mask;
+    for (uint32_t probe = 0; probe <= mask; probe++, slot = (slot + 1) & mask) { // Линейное пробирование, не больше таблицы
+        uint32_t index = archive->table[slot];
+        if (index == 0 || index > archive->header->numEntries)
+            return -1;
+        const ArchiveEntry* e = &archive->entries[index - 1];
+        if (e->nameHash == hash && e->nameLength == length && memcmp(archive->names + e->nameOffset, name, length) == 0)
+            return (int)(index - 1);
+    }
+    return -1; // В поврежденной таблице нет пустых слотов
+}
+
+const void* archiveData(const Archive* archive, int entry, size_t* size, void** owned)
+{
+    const ArchiveEntry* e = &archive->entries[entry];
+    const unsigned char* data = (const unsigned char*)archive->map + e->offset;
+    *owned = NULL;
+    *size = (size_t)e->rawSize;
+    if (e->compression == ARCHIVE_STORED)
+        return data;
+    unsigned char* raw = malloc(e->rawSize ? e->rawSize : 1);
+    if (!raw || lz4Decompress(data, (size_t)e->size, raw, (size_t)e->rawSize) != 0) {
+        printf("Failed to decompress archive entry: %s\n", archive->names + e->nameOffset);
+        free(raw);
+        return NULL;
+    }
+    *owned = raw;
+    return raw;
+}
+
+static uint32_t read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+size_t lz4Bound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+static unsigned char* writeLength(unsigned char* op, size_t length)
+{
+    for (; length >= 255; length -= 255)
+        *op++ = 255;
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+// Жадный поиск совпадений по хешу 4 байт, одна позиция на слот
+size_t lz4Compress(const unsigned char* src, size_t size, unsigned char* dst, size_t capacity)
+{
+    if (capacity < lz4Bound(size))
+        return 0;
+    uint32_t* table = malloc(sizeof(uint32_t) << LZ4_HASH_BITS);
+    if (!table)
+        return 0;
+    memset(table, 0xFF, sizeof(uint32_t) << LZ4_HASH_BITS);
+    unsigned char* op = dst;
+    size_t anchor = 0, ip = 0;
+    size_t matchLimit = size > LZ4_LAST_LITERALS ? size - LZ4_LAST_LITERALS : 0;
+    while (size >= LZ4_MF_LIMIT + 1 && ip + LZ4_MF_LIMIT < size) {
+        uint32_t seq = read32(src + ip);
+        uint32_t h = (seq * 2654435761u) >> (32 - LZ4_HASH_BITS);
+        uint32_t ref = table[h];
+        table[h] = (uint32_t)ip;
+        if (ref == 0xFFFFFFFFu || ip - ref > LZ4_MAX_OFFSET || read32(src + ref) != seq) {
+            ip++;
+            continue;
+        }
+        size_t length = LZ4_MIN_MATCH;
+        while (ip + length < matchLimit && src[ref + length] == src[ip + length])
+            length++;
+
+        size_t literals = ip - anchor;
+        unsigned char* token = op++;
+        *token = (unsigned char)((literals >= 15 ? 15 : literals) << 4);
+        if (literals >= 15)
+            op = writeLength(op, literals - 15);
+        memcpy(op, src + anchor, literals);
+        op += literals;
+        uint16_t offset = (uint16_t)(ip - ref);
+        *op++ = offset & 0xFF;
+        *op++ = offset >> 8;
+        size_t extra = length - LZ4_MIN_MATCH;
+        *token |= (unsigned char)(extra >= 15 ? 15 : extra);
+        if (extra >= 15)
+            op = writeLength(op, extra - 15);
+        ip += length;
+        anchor = ip;
+    }
+    // Хвост литералами
+    size_t literals = size - anchor;
+    *op++ = (unsigned char)((literals >= 15 ? 15 : literals) << 4);
+    if (literals >= 15)
+        op = writeLength(op, literals - 15);
+    memcpy(op, src + anchor, literals);
+    op += literals;
+    free(table);
+    return (size_t)(op - dst);
+}
+
+int lz4Decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize)
+{
+    const unsigned char* ip = src;
+    const unsigned char* end = src + srcSize;
+    size_t op = 0;
+    while (ip < end) {
+        unsigned int token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            unsigned int b;
+            do {
+                if (ip >= end)
+                    return -1;
+                b = *ip++;
+                literals += b;
+            } while (b == 255);
+        }
+        if (literals > (size_t)(end - ip) || literals > dstSize - op)
+            return -1;
+        memcpy(dst + op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == end)
+            break; // Последняя последовательность - без совпадения
+        if (end - ip < 2)
+            return -1;
+        size_t offset = ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        size_t length = (token & 15) + LZ4_MIN_MATCH;
+        if ((token & 15) == 15) {
+            unsigned int b;
+            do {
+                if (ip >= end)
+                    return -1;
+                b = *ip++;
+                length += b;
+            } while (b == 255);
+        }
+        if (offset == 0 || offset > op || length > dstSize - op)
+            return -1;
+        for (size_t i = 0; i < length; i++) // Побайтно: совпадение может перекрывать само себя
+            dst[op + i] = dst[op - offset + i];
+        op += length;
+    }
+    return op == dstSize ? 0 : -1;
+}
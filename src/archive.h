@@ -0,0 +1,62 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARCHIVE_MAGIC "G3DA"
+#define ARCHIVE_VERSION 2
+#define ARCHIVE_ALIGN 4096 // Записи с границы страницы: mmap отдает их без копирования
+
+#define ARCHIVE_STORED 0
+#define ARCHIVE_LZ4 1 // Блочный формат LZ4
+
+typedef struct { // Заголовок .g3da; записи с ARCHIVE_ALIGN, оглавление в конце файла
+    char magic[4];
+    uint32_t version;
+    uint32_t numEntries;
+    uint32_t tableSize; // Слотов хеш-таблицы (степень двойки)
+    uint64_t tocOffset; // Записи ArchiveEntry, затем uint32 слоты таблицы (индекс + 1), затем имена
+    uint64_t tocSize;
+} ArchiveHeader;
+
+typedef struct {
+    uint64_t nameHash; // FNV-1a 64 имени
+    uint64_t offset;
+    uint64_t size;    // Байт в файле
+    uint64_t rawSize; // Байт после распаковки
+    uint64_t contentHash; // hashContent распакованных данных: ключ готовки без чтения самой записи
+    uint32_t nameOffset, nameLength;
+    uint32_t compression; // ARCHIVE_*
+    uint32_t reserved;
+} ArchiveEntry;
+
+typedef struct {
+    void* map; // Начало архива: отображение файла или встроенные в программу данные
+    size_t mapSize;
+    int mapped;
+    const ArchiveHeader* header;
+    const ArchiveEntry* entries;
+    const uint32_t* table;
+    const char* names;
+} Archive;
+
+uint64_t archiveHash(const char* name);
+// Отображает архив и проверяет оглавление. 0 при успехе
+int openArchive(const char* path, Archive* archive);
+// Архив, уже лежащий в памяти (встроенный в программу); data должна жить дольше архива
+int openArchiveMemory(const void* data, size_t size, Archive* archive);
+void closeArchive(Archive* archive);
+// Индекс записи или -1
+int archiveFind(const Archive* archive, const char* name);
+// Данные записи: несжатая - указатель в отображение, сжатая - распакованный буфер в *owned (освободить).
+// NULL при ошибке
+const void* archiveData(const Archive* archive, int entry, size_t* size, void** owned);
+
+// LZ4 (блочный формат): 0, если результат не влез в capacity
+size_t lz4Compress(const unsigned char* src, size_t size, unsigned char* dst, size_t capacity);
+size_t lz4Bound(size_t size);
+// 0 при успехе: ровно dstSize байт, без выхода за границы
+int lz4Decompress(const unsigned char* src, size_t srcSize, unsigned char* dst, size_t dstSize);
+
+#endif
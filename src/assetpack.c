@@ -0,0 +1,255 @@
+// Упаковка каталога ресурсов в один архив .g3da: ./assetpack [каталог] [архив] [--lz4] [--embed файл.c]
+// По умолчанию ../res -> assets.g3da (рядом с игрой). Подкаталоги пакуются с префиксом "подкаталог/", так что
+// готовые .g3dm/.g3dt из cooked/ попадают в архив вместе с исходниками.
+// --embed дополнительно пишет архив как выровненный массив C для сборки игры с -DEMBED_ASSETS=1.
+// Сборка: gcc -O2 assetpack.c archive.c cook.c -o assetpack
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "archive.h"
+#include "cook.h"
+
+#define PACK_MAX_ENTRIES 1024
+
+typedef struct {
+    char name[256];
+    ArchiveEntry entry;
+} PackItem;
+
+static int compareNames(const void* a, const void* b)
+{
+    return strcmp(((const PackItem*)a)->name, ((const PackItem*)b)->name);
+}
+
+// Архив как массив C, выровненный как ARCHIVE_ALIGN: записи в памяти остаются на границах страниц
+static int writeEmbedded(const char* archivePath, const char* out)
+{
+    const unsigned char* data;
+    size_t size;
+    if (mapFile(archivePath, (const void**)&data, &size) != 0 || size == 0) {
+        printf("Failed to read archive: %s\n", archivePath);
+        return -1;
+    }
+    char tmpPath[520];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", out);
+    FILE* f = fopen(tmpPath, "w");
+    int ok = f != NULL;
+    if (f) {
+        fprintf(f, "// Сгенерировано assetpack из %s, не редактировать\n#include <stddef.h>\n\n", archivePath);
+        // Строковые литералы с восьмеричными escape компилируются на порядок быстрее списка чисел;
+        // размер массива без места под завершающий ноль, так что он не добавляется
+        fprintf(f, "__attribute__((aligned(%d))) const unsigned char embeddedArchive[%zu] =\n", ARCHIVE_ALIGN, size);
+        for (size_t i = 0; i < size; i++)
+            fprintf(f, "%s\\%03o%s", i % 64 == 0 ? "\"" : "", data[i], i % 64 == 63 || i + 1 == size ? "\"\n" : "");
+        fprintf(f, ";\nconst size_t embeddedArchiveSize = %zu;\n", size);
+        ok = !ferror(f);
+        ok = (fclose(f) == 0) && ok;
+    }
+    unmapFile(data, size);
+    if (!ok || rename(tmpPath, out) != 0) {
+        printf("Failed to write embedded archive: %s\n", out);
+        remove(tmpPath);
+        return -1;
+    }
+    printf("%s: %zu bytes embedded\n", out, size);
+    return 0;
+}
+
+static int padTo(FILE* f, uint64_t* pos, uint64_t align)
+{
+    static const char zeros[ARCHIVE_ALIGN] = {0};
+    uint64_t pad = (align - *pos % align) % align;
+    *pos += pad;
+    return fwrite(zeros, 1, pad, f) == pad;
+}
+
+// Файлы каталога в items; prefix - путь относительно корня, с которым подкаталоги и пакуются. 0 при успехе
+static int scanDir(const char* root, const char* prefix, PackItem* items, int* count)
+{
+    char dirPath[512];
+    snprintf(dirPath, sizeof(dirPath), "%s/%s", root, prefix);
+    DIR* d = opendir(dirPath);
+    if (!d) {
+        printf("Failed to open directory: %s\n", dirPath);
+        return -1;
+    }
+    int ok = 1;
+    for (struct dirent* de; ok && (de = readdir(d));) {
+        char name[256], path[768];
+        struct stat st;
+        int n = snprintf(name, sizeof(name), "%s%s", prefix, de->d_name);
+        snprintf(path, sizeof(path), "%s/%s", root, name);
+        if (de->d_name[0] == '.' || strchr(de->d_name, ':') || strstr(de->d_name, ".tmp") ||
+            n >= (int)sizeof(name) - 1 || stat(path, &st) != 0)
+            continue; // Служебные файлы (Zone.Identifier, временные) не пакуются
+        if (S_ISDIR(st.st_mode)) {
+            strcat(name, "/");
+            ok = scanDir(root, name, items, count) == 0;
+            continue;
+        }
+        if (!S_ISREG(st.st_mode))
+            continue;
+        if (*count == PACK_MAX_ENTRIES) {
+            printf("Too many files in %s\n", root);
+            ok = 0;
+            break;
+        }
+        memset(&items[*count], 0, sizeof(items[*count]));
+        strcpy(items[*count].name, name);
+        (*count)++;
+    }
+    closedir(d);
+    return ok ? 0 : -1;
+}
+
+int main(int argc, char** argv)
+{
+    const char* args[2] = {"../res", "assets.g3da"};
+    const char* embed = NULL;
+    int nargs = 0, compress = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--lz4") == 0)
+            compress = 1;
+        else if (strcmp(argv[i], "--embed") == 0 && i + 1 < argc)
+            embed = argv[++i];
+        else if (nargs < 2)
+            args[nargs++] = argv[i];
+    }
+    const char* dir = args[0];
+    const char* out = args[1];
+
+    // Имена в порядке сортировки - архив воспроизводим побайтно
+    static PackItem items[PACK_MAX_ENTRIES];
+    int count = 0;
+    if (scanDir(dir, "", items, &count) != 0)
+        return 1;
+    qsort(items, count, sizeof(PackItem), compareNames);
+
+    char tmpPath[520];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", out);
+    FILE* f = fopen(tmpPath, "wb");
+    if (!f) {
+        printf("Failed to write archive: %s\n", out);
+        return 1;
+    }
+    ArchiveHeader h;
+    memset(&h, 0, sizeof(h));
+    uint64_t pos = 0;
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    pos += sizeof(h);
+    uint64_t rawTotal = 0, storedTotal = 0;
+    for (int i = 0; ok && i < count; i++) {
+        char path[768];
+        snprintf(path, sizeof(path), "%s/%.255s", dir, items[i].name);
+        int fd = open(path, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            printf("Failed to read %s\n", path);
+            if (fd >= 0)
+                close(fd);
+            ok = 0;
+            break;
+        }
+        size_t size = (size_t)st.st_size;
+        const unsigned char* data = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+        close(fd);
+        if (data == MAP_FAILED) {
+            printf("Failed to read %s\n", path);
+            ok = 0;
+            break;
+        }
+
+        // Сжатая копия сохраняется, только если экономит хотя бы восьмую часть
+        unsigned char* packed = NULL;
+        size_t packedSize = 0;
+        if (compress && size > 0 && (packed = malloc(lz4Bound(size)))) {
+            packedSize = lz4Compress(data, size, packed, lz4Bound(size));
+            if (packedSize == 0 || packedSize > size - size / 8) {
+                free(packed);
+                packed = NULL;
+            }
+        }
+        ArchiveEntry* e = &items[i].entry;
+        ok = padTo(f, &pos, ARCHIVE_ALIGN);
+        e->nameHash = archiveHash(items[i].name);
+        e->offset = pos;
+        e->rawSize = size;
+        e->contentHash = hashContent(data, size);
+        e->compression = packed ? ARCHIVE_LZ4 : ARCHIVE_STORED;
+        e->size = packed ? packedSize : size;
+        ok = ok && fwrite(packed ? packed : data, 1, e->size, f) == e->size;
+        pos += e->size;
+        rawTotal += size;
+        storedTotal += e->size;
+        printf("%-28s %10zu -> %10llu%s\n", items[i].name, size, (unsigned long long)e->size, packed ? " lz4" : "");
+        free(packed);
+        if (data)
+            munmap((void*)data, size);
+    }
+
+    // Оглавление: записи, хеш-таблица с линейным пробированием, имена
+    uint32_t tableSize = 16;
+    while (tableSize < (uint32_t)count * 2)
+        tableSize <<= 1;
+    uint32_t* table = calloc(tableSize, sizeof(uint32_t));
+    uint32_t nameOffset = 0;
+    for (int i = 0; i < count; i++) {
+        items[i].entry.nameOffset = nameOffset;
+        items[i].entry.nameLength = (uint32_t)strlen(items[i].name);
+        nameOffset += items[i].entry.nameLength + 1;
+        uint32_t slot = (uint32_t)items[i].entry.nameHash & (tableSize - 1);
+        while (table && table[slot])
+            slot = (slot + 1) & (tableSize - 1);
+        if (table)
+            table[slot] = (uint32_t)i + 1;
+    }
+    ok = ok && table && padTo(f, &pos, 8);
+    h.tocOffset = pos;
+    for (int i = 0; ok && i < count; i++)
+        ok = fwrite(&items[i].entry, sizeof(ArchiveEntry), 1, f) == 1;
+    ok = ok && fwrite(table, sizeof(uint32_t), tableSize, f) == tableSize;
+    for (int i = 0; ok && i < count; i++)
+        ok = fwrite(items[i].name, 1, items[i].entry.nameLength + 1, f) == items[i].entry.nameLength + 1;
+    free(table);
+    memcpy(h.magic, ARCHIVE_MAGIC, 4);
+    h.version = ARCHIVE_VERSION;
+    h.numEntries = (uint32_t)count;
+    h.tableSize = tableSize;
+    h.tocSize = (uint64_t)count * sizeof(ArchiveEntry) + (uint64_t)tableSize * sizeof(uint32_t) + nameOffset;
+    ok = ok && fseek(f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, f) == 1;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmpPath, out) != 0) {
+        printf("Failed to write archive: %s\n", out);
+        remove(tmpPath);
+        return 1;
+    }
+    printf("%s: %d entries, %.2f MB -> %.2f MB\n", out, count, rawTotal / (1024.0 * 1024.0),
+           storedTotal / (1024.0 * 1024.0));
+
+    // Проверка: каждая запись находится по имени и читается обратно
+    Archive archive;
+    if (openArchive(out, &archive) != 0)
+        return 1;
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        int index = archiveFind(&archive, items[i].name);
+        size_t size;
+        void* owned = NULL;
+        const void* data = index >= 0 ? archiveData(&archive, index, &size, &owned) : NULL;
+        if (!data || size != items[i].entry.rawSize || hashContent(data, size) != archive.entries[index].contentHash) {
+            printf("Archive check failed: %s\n", items[i].name);
+            failed = 1;
+        }
+        free(owned);
+    }
+    closeArchive(&archive);
+    if (!failed && embed && writeEmbedded(out, embed) != 0)
+        failed = 1;
+    return failed;
+}
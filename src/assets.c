@@ -0,0 +1,115 @@
+#include "assets.h"
+
+#include <string.h>
+#include <unistd.h>
+
+void assetInit(AssetScheduler* s, int threads)
+{
+    memset(s, 0, sizeof(*s));
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    s->numThreads = threads < ASSET_MAX_THREADS ? threads : ASSET_MAX_THREADS;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->jobDone, NULL);
+}
+
+int assetAddJob(AssetScheduler* s, void (*run)(void* arg), void* arg)
+{
+    if (s->numJobs >= ASSET_MAX_JOBS)
+        return -1;
+    s->jobs[s->numJobs].run = run;
+    s->jobs[s->numJobs].arg = arg;
+    return s->numJobs++;
+}
+
+int assetAddGroup(AssetScheduler* s, const int* jobs, int numJobs)
+{
+    if (s->numGroups >= ASSET_MAX_GROUPS)
+        return -1;
+    unsigned int mask = 0;
+    for (int i = 0; i < numJobs; i++)
+        if (jobs[i] >= 0 && jobs[i] < s->numJobs)
+            mask |= 1u << jobs[i];
+    s->groupJobs[s->numGroups] = mask;
+    return s->numGroups++;
+}
+
+// Поток берет задачи по порядку, пока они не кончатся
+static void* assetWorker(void* arg)
+{
+    AssetScheduler* s = arg;
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        int job = s->nextJob < s->numJobs ? s->nextJob++ : -1;
+        pthread_mutex_unlock(&s->lock);
+        if (job < 0)
+            return NULL;
+        s->jobs[job].run(s->jobs[job].arg);
+        pthread_mutex_lock(&s->lock);
+        s->jobsDone |= 1u << job;
+        pthread_cond_broadcast(&s->jobDone);
+        pthread_mutex_unlock(&s->lock);
+    }
+}
+
+void assetStart(AssetScheduler* s)
+{
+    int threads = s->numThreads < s->numJobs ? s->numThreads : s->numJobs;
+    int started = 0;
+    for (int i = 0; i < threads; i++)
+        if (pthread_create(&s->threads[started], NULL, assetWorker, s) == 0)
+            started++;
+    s->numThreads = started;
+    if (started == 0) // Потоки не создались - все задачи в текущем потоке
+        assetWorker(s);
+}
+
+// Под блокировкой: первая еще не отданная группа, все задачи которой готовы; *pending - есть ли неготовые
+static int takeReadyGroup(AssetScheduler* s, int* pending)
+{
+    *pending = 0;
+    for (int g = 0; g < s->numGroups; g++) {
+        if (s->groupsTaken & (1u << g))
+            continue;
+        if ((s->jobsDone & s->groupJobs[g]) == s->groupJobs[g]) {
+            s->groupsTaken |= 1u << g;
+            return g;
+        }
+        *pending = 1;
+    }
+    return -1;
+}
+
+int assetNextGroup(AssetScheduler* s)
+{
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        int pending;
+        int g = takeReadyGroup(s, &pending);
+        if (g >= 0 || !pending) {
+            pthread_mutex_unlock(&s->lock);
+            return g;
+        }
+        pthread_cond_wait(&s->jobDone, &s->lock);
+    }
+}
+
+int assetPollGroup(AssetScheduler* s)
+{
+    int pending;
+    pthread_mutex_lock(&s->lock);
+    int g = takeReadyGroup(s, &pending);
+    pthread_mutex_unlock(&s->lock);
+    return g;
+}
+
+void assetShutdown(AssetScheduler* s)
+{
+    for (int i = 0; i < s->numThreads; i++)
+        pthread_join(s->threads[i], NULL);
+    s->numThreads = 0;
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->jobDone);
+}
@@ -0,0 +1,43 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <pthread.h>
+
+#define ASSET_MAX_JOBS 32
+#define ASSET_MAX_GROUPS 32
+#define ASSET_MAX_THREADS 8
+
+typedef struct {
+    void (*run)(void* arg); // Выполняется на рабочем потоке, без вызовов GL
+    void* arg;
+} AssetJob;
+
+// Пул потоков для разбора и декодирования ресурсов. Задачи объединяются в группы:
+// группа отдается потоку GL, только когда готовы все ее задачи (например, меш и его текстура)
+typedef struct {
+    AssetJob jobs[ASSET_MAX_JOBS];
+    unsigned int groupJobs[ASSET_MAX_GROUPS]; // Битовые маски задач группы
+    int numJobs, numGroups, nextJob;
+    unsigned int jobsDone, groupsTaken;
+
+    pthread_t threads[ASSET_MAX_THREADS];
+    int numThreads;
+    pthread_mutex_t lock;
+    pthread_cond_t jobDone;
+} AssetScheduler;
+
+// threads = 0 - по числу ядер (не больше ASSET_MAX_THREADS)
+void assetInit(AssetScheduler* s, int threads);
+// Номер задачи или -1, если места нет
+int assetAddJob(AssetScheduler* s, void (*run)(void* arg), void* arg);
+// Номер группы или -1
+int assetAddGroup(AssetScheduler* s, const int* jobs, int numJobs);
+// Запуск потоков; задачи добавляются до запуска
+void assetStart(AssetScheduler* s);
+// Ждет любую группу, все задачи которой готовы, и возвращает ее номер; -1, когда группы кончились
+int assetNextGroup(AssetScheduler* s);
+// То же без ожидания: -1, если сейчас готовой группы нет
+int assetPollGroup(AssetScheduler* s);
+void assetShutdown(AssetScheduler* s);
+
+#endif
@@ -0,0 +1,173 @@
+// Сравнение проверки столкновений: прежние скалярные циклы (каждый враг против всех пуль) против сетки с пачками SIMD,
+// и отдельно ядро collidePoints (Scalar/Simd) на всех пулях против всех врагов. 100, 1000 и 10000 пуль, половина -
+// пули врагов; результаты сверяются. Сборка: gcc -O2 -DMAX_BULLETS=10000 collbench.c sim.c -o collbench -lm
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "sim.h"
+
+#define BENCH_TIME 0.2 // Секунд на замер
+
+_Static_assert(MAX_BULLETS >= 10000, "collbench needs -DMAX_BULLETS=10000");
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// updateEnemy и updatePlayerHits до сетки и ядра
+static void scalarLoops(float px)
+{
+    for (int j = 0; j < MAX_ENEMIES; j++)
+    {
+        if (ENEMY_BIT(enemies.active, j))
+        {
+            for (int i = 0; i < bullets.count;)
+            {
+                if ((fabs(bullets.x[i] - enemies.x[j]) <= ENEMY_SIZEX) &&
+                    (fabs(bullets.y[i] - enemies.y[j]) <= ENEMY_SIZEY) && (bullets.dir[i] == 1))
+                {
+                    enemies.lives[j]--;
+                    removeBullet(i);
+                    enemies.hit[j] = 1;
+                    if (enemies.lives[j] == 0)
+                    {
+                        ENEMY_CLEAR(enemies.active, j);
+                        ENEMY_CLEAR(enemies.diving, j);
+                        kills++;
+                    }
+                }
+                else
+                    i++;
+            }
+        }
+    }
+    for (int i = 0; i < bullets.count;)
+    {
+        if ((fabs(bullets.x[i] - px) <= PLAYER_COLLIDE_RX) &&
+            (fabs(bullets.y[i] - STARTPLY) <= PLAYER_COLLIDE_RY) && (bullets.dir[i] == -1))
+        {
+            playerHits++;
+            playerIsHit = 1;
+            removeBullet(i);
+        }
+        else
+            i++;
+    }
+}
+
+static void batchedKernels(float px)
+{
+    updateEnemy();
+    updatePlayerHits(px);
+}
+
+// Сумма позиций оставшихся пуль не зависит от их порядка в пуле
+static double bulletSum()
+{
+    double sum = 0;
+    for (int i = 0; i < bullets.count; i++)
+        sum += bullets.x[i] * 3.0 + bullets.y[i] * 7.0 + bullets.dir[i];
+    return sum;
+}
+
+static BulletPool sceneBullets;
+static EnemyPool sceneEnemies;
+
+// Секунд на вызов; состояние восстанавливается перед каждым, копирование вычитается
+static double timeUpdate(void (*update)(float), float px)
+{
+    long calls = 0;
+    double t0 = now(), t = 0;
+    while ((t = now() - t0) < BENCH_TIME) {
+        bullets = sceneBullets;
+        enemies = sceneEnemies;
+        update(px);
+        calls++;
+    }
+    double perCall = t / calls;
+    t0 = now();
+    for (long n = 0; n < calls; n++) {
+        bullets = sceneBullets;
+        enemies = sceneEnemies;
+        __asm__ volatile("" ::: "memory");
+    }
+    return perCall - (now() - t0) / calls;
+}
+
+static double timeKernel(int simd, CollisionHit* hits, int* numHits)
+{
+    long calls = 0;
+    double t0 = now(), t = 0;
+    while ((t = now() - t0) < BENCH_TIME) {
+        if (simd)
+            *numHits = collidePointsSimd(bullets.x, bullets.y, bullets.dir, 1, bullets.count, enemies.x, enemies.y,
+                                         FORMATION_ROWS * FORMATION_COLS, ENEMY_SIZEX, ENEMY_SIZEY, hits);
+        else
+            *numHits = collidePointsScalar(bullets.x, bullets.y, bullets.dir, 1, bullets.count, enemies.x, enemies.y,
+                                           FORMATION_ROWS * FORMATION_COLS, ENEMY_SIZEX, ENEMY_SIZEY, hits);
+        calls++;
+    }
+    return t / calls;
+}
+
+int main()
+{
+    static CollisionHit hitsScalar[MAX_BULLETS], hitsSimd[MAX_BULLETS];
+    const int counts[] = {100, 1000, 10000};
+    const float px = 0.1f;
+    int failed = 0;
+    printf("COLLIDE_SIMD %d, %d enemies\n", COLLIDE_SIMD, FORMATION_ROWS * FORMATION_COLS);
+    for (int n = 0; n < 3; n++) {
+        // Строй из spawnFormation с запасом жизней, чтобы враги не кончались; пули над строем и у игрока
+        simInit(1);
+        for (int j = 0; j < MAX_ENEMIES; j++)
+            enemies.lives[j] = 1 << 30;
+        SimRng rng;
+        simRngSeed(&rng, (uint64_t)counts[n]);
+        for (int i = 0; i < counts[n]; i++) {
+            float x = (simRngNext(&rng) >> 8) * (2.0f / 16777216.0f) - 1.0f;
+            float y = (simRngNext(&rng) >> 8) * (2.0f / 16777216.0f) - 1.0f;
+            spawnBullet(x, y, i & 1 ? -1 : 1);
+        }
+        sceneBullets = bullets;
+        sceneEnemies = enemies;
+
+        bullets = sceneBullets;
+        enemies = sceneEnemies;
+        scalarLoops(px);
+        int scalarKills = kills, scalarPlayerHits = playerHits, scalarCount = bullets.count;
+        double scalarSum = bulletSum();
+        int scalarLives[MAX_ENEMIES];
+        memcpy(scalarLives, enemies.lives, sizeof(scalarLives));
+        kills = playerHits = 0;
+        bullets = sceneBullets;
+        enemies = sceneEnemies;
+        batchedKernels(px);
+        if (kills != scalarKills || playerHits != scalarPlayerHits || bullets.count != scalarCount ||
+            bulletSum() != scalarSum || memcmp(scalarLives, enemies.lives, sizeof(scalarLives)) != 0) {
+            printf("%d bullets: batched collisions differ from the scalar loops\n", counts[n]);
+            failed = 1;
+        }
+        int hits = sceneBullets.count - bullets.count;
+
+        double loops = timeUpdate(scalarLoops, px), batched = timeUpdate(batchedKernels, px);
+        bullets = sceneBullets;
+        enemies = sceneEnemies;
+        int numScalar = 0, numSimd = 0;
+        double kernelScalar = timeKernel(0, hitsScalar, &numScalar), kernelSimd = timeKernel(1, hitsSimd, &numSimd);
+        if (numScalar != numSimd || memcmp(hitsScalar, hitsSimd, numScalar * sizeof(CollisionHit)) != 0) {
+            printf("%d bullets: collidePointsSimd differs from collidePointsScalar\n", counts[n]);
+            failed = 1;
+        }
+        printf("%5d bullets, %4d hits: scalar loops %8.2f us, grid + batched %7.2f us (%.1fx); "
+               "kernel all vs all: scalar %8.2f us, SIMD %7.2f us (%.1fx)\n",
+               counts[n], hits, loops * 1e6, batched * 1e6, loops / batched, kernelScalar * 1e6, kernelSimd * 1e6,
+               kernelScalar / kernelSimd);
+    }
+    return failed;
+}
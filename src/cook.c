@@ -0,0 +1,94 @@
+#include "cook.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define COOK_HASH_MUL 0x9E3779B97F4A7C15ull
+
+static uint64_t mix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t hashContent(const void* data, size_t size)
+{
+    const unsigned char* p = data;
+    uint64_t h = size * COOK_HASH_MUL;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t v;
+        memcpy(&v, p + i, 8);
+        h = (h ^ mix64(v)) * COOK_HASH_MUL;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0; // Остаток меньше 8 байт
+    if (size > i)
+        memcpy(&tail, p + i, size - i);
+    h = (h ^ mix64(tail ^ (size - i))) * COOK_HASH_MUL;
+    return mix64(h);
+}
+
+uint64_t cookKey(uint64_t srcHash, const void* params, size_t paramsSize)
+{
+    return mix64(srcHash ^ hashContent(params, paramsSize) * COOK_HASH_MUL);
+}
+
+void cookName(char* out, size_t outSize, uint64_t key, const char* ext)
+{
+    snprintf(out, outSize, "%s%016llx%s", COOK_DIR, (unsigned long long)key, ext);
+}
+
+int makeParentDir(const char* path)
+{
+    char dir[512];
+    const char* slash = strrchr(path, '/');
+    if (!slash)
+        return 0;
+    size_t n = (size_t)(slash - path);
+    if (n == 0 || n >= sizeof(dir))
+        return n == 0 ? 0 : -1;
+    memcpy(dir, path, n);
+    dir[n] = 0;
+    return mkdir(dir, 0755) == 0 || errno == EEXIST ? 0 : -1;
+}
+
+int mapFile(const char* path, const void** data, size_t* size)
+{
+    *data = NULL;
+    *size = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size > 0) {
+        void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        *data = map;
+        *size = (size_t)st.st_size;
+    }
+    close(fd);
+    return 0;
+}
+
+void unmapFile(const void* data, size_t size)
+{
+    if (data)
+        munmap((void*)data, size);
+}
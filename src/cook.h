@@ -0,0 +1,22 @@
+#ifndef COOK_H
+#define COOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define COOK_DIR "cooked/" // Подкаталог ресурсов (и префикс в архиве) для результатов готовки
+
+// Хеш содержимого (64 бита, по 8 байт за шаг)
+uint64_t hashContent(const void* data, size_t size);
+// Ключ готовки: хеш исходника плюс все параметры, от которых зависит результат
+uint64_t cookKey(uint64_t srcHash, const void* params, size_t paramsSize);
+// "cooked/<ключ hex><ext>" - имя результата в каталоге ресурсов и в архиве
+void cookName(char* out, size_t outSize, uint64_t key, const char* ext);
+// Создает каталог, в котором лежит path (один уровень). 0 при успехе или если он уже есть
+int makeParentDir(const char* path);
+
+// Файл целиком через mmap (только чтение). 0 при успехе; пустой файл - data = NULL
+int mapFile(const char* path, const void** data, size_t* size);
+void unmapFile(const void* data, size_t size);
+
+#endif
@@ -0,0 +1,208 @@
+// Симуляция без окна и GL с максимальной скоростью: ./headless [тиков] [seed] [--record file.g3dr] | --replay file.g3dr
+// Управляет бот: стреляет всегда, меняет направление каждые полторы секунды. После поражения игра начинается заново
+// со следующим seed (при --record запись заканчивается). Хеш состояния в конце одинаков для одинаковых аргументов -
+// прогоны можно сравнивать. --replay проигрывает записанную игру (ее же пишет игра) вместо бота.
+// --check-simd сверяет SIMD-движение врагов со скалярным эталоном (случайные состояния и каждый тик игры) и сравнивает
+// их скорость; для большого числа врагов: -DMAX_ENEMIES=1024.
+// Сборка: gcc -O2 headless.c sim.c replay.c -o headless -lm
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <string.h>
+
+#include "sim.h"
+#include "replay.h"
+
+#define HEADLESS_TICKS 1000000
+#define HEADLESS_SEED 1
+#define BOT_TURN_TICKS 90
+#define CHECK_STATES 100000 // Случайных состояний врагов для --check-simd
+#define CHECK_BENCH_CALLS 200000
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Одинаково ли подвинули врагов два пути: позиции и скорости бит в бит, те же улетевшие
+static int sameMove(const EnemyPool* a, const EnemyPool* b, const uint64_t* exitedA, const uint64_t* exitedB)
+{
+    return memcmp(a->x, b->x, sizeof(a->x)) == 0 && memcmp(a->y, b->y, sizeof(a->y)) == 0 &&
+           memcmp(a->speedX, b->speedX, sizeof(a->speedX)) == 0 && memcmp(a->speedY, b->speedY, sizeof(a->speedY)) == 0 &&
+           memcmp(exitedA, exitedB, ENEMY_MASK_WORDS * sizeof(uint64_t)) == 0;
+}
+
+static float randomFloat(SimRng* rng, float lo, float hi)
+{
+    return lo + (hi - lo) * (simRngNext(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+// Случайные враги: любые маски, позиции у краев и за ними, часть - ровно на игроке (нулевое расстояние)
+static void randomEnemies(SimRng* rng, EnemyPool* e, float* px)
+{
+    memset(e, 0, sizeof(*e));
+    *px = randomFloat(rng, -1.0f, 1.0f);
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        uint32_t r = simRngNext(rng);
+        if (r & 1)
+            ENEMY_SET(e->active, i);
+        if ((r & 6) == 6 && (r & 1))
+            ENEMY_SET(e->diving, i);
+        e->x[i] = randomFloat(rng, -1.1f, 1.1f);
+        e->y[i] = randomFloat(rng, -1.0f, 1.0f);
+        e->speedX[i] = randomFloat(rng, -0.3f, 0.3f);
+        e->speedY[i] = randomFloat(rng, -0.3f, 0.3f);
+        if ((r & 0xf0) == 0) {
+            e->x[i] = *px;
+            e->y[i] = STARTPLY;
+        }
+    }
+}
+
+static int checkEnemySimd(uint64_t seed)
+{
+    if (!ENEMY_SIMD)
+        printf("ENEMY_SIMD is 0: the SIMD path is the scalar reference\n");
+    static EnemyPool a, b;
+    uint64_t exitedA[ENEMY_MASK_WORDS], exitedB[ENEMY_MASK_WORDS];
+    SimRng rng;
+    simRngSeed(&rng, seed);
+    for (int n = 0; n < CHECK_STATES; n++) {
+        float px;
+        randomEnemies(&rng, &a, &px);
+        b = a;
+        moveEnemiesScalar(&a, px, exitedA);
+        moveEnemiesSimd(&b, px, exitedB);
+        if (!sameMove(&a, &b, exitedA, exitedB)) {
+            printf("SIMD enemy movement differs from scalar: random state %d\n", n);
+            return 1;
+        }
+    }
+
+    long ticks = 0;
+    simInit(seed);
+    SimInput input = {0};
+    for (; ticks < HEADLESS_TICKS / 10 && !gameOver; ticks++) { // Игра ботом: каждый тик оба пути на копиях
+        a = b = enemies;
+        moveEnemiesScalar(&a, playerX, exitedA);
+        moveEnemiesSimd(&b, playerX, exitedB);
+        if (!sameMove(&a, &b, exitedA, exitedB)) {
+            printf("SIMD enemy movement differs from scalar: game tick %ld\n", ticks);
+            return 1;
+        }
+        input.right = (ticks / BOT_TURN_TICKS) % 2;
+        input.left = !input.right;
+        input.fire = 1;
+        simTick(&input);
+    }
+    printf("SIMD enemy movement matches scalar: %d random states, %ld game ticks\n", CHECK_STATES, ticks);
+
+    float px; // Скорость - на состоянии как в игре: все живы, пикирует каждый шестнадцатый
+    randomEnemies(&rng, &a, &px);
+    memset(a.diving, 0, sizeof(a.diving));
+    for (int i = 0; i < MAX_ENEMIES; i++) {
+        ENEMY_SET(a.active, i);
+        if (i % 16 == 0)
+            ENEMY_SET(a.diving, i);
+    }
+    b = a;
+    double t0 = now();
+    for (int n = 0; n < CHECK_BENCH_CALLS; n++)
+        moveEnemiesScalar(&a, px, exitedA);
+    double t1 = now();
+    for (int n = 0; n < CHECK_BENCH_CALLS; n++)
+        moveEnemiesSimd(&b, px, exitedB);
+    double t2 = now();
+    double scalar = (t1 - t0) / CHECK_BENCH_CALLS * 1e9, simd = (t2 - t1) / CHECK_BENCH_CALLS * 1e9;
+    printf("%d enemies: scalar %.0f ns, SIMD %.0f ns per update (%.1fx)\n", MAX_ENEMIES, scalar, simd, scalar / simd);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    long ticks = HEADLESS_TICKS;
+    uint64_t seed = HEADLESS_SEED;
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    int positional = 0, checkSimd = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (strcmp(argv[i], "--check-simd") == 0)
+            checkSimd = 1;
+        else if (positional == 0 && argv[i][0] != '-' && (ticks = atol(argv[i])) > 0)
+            positional++;
+        else if (positional == 1 && argv[i][0] != '-') {
+            seed = strtoull(argv[i], NULL, 10);
+            positional++;
+        }
+        else {
+            printf("Usage: %s [ticks] [seed] [--record file.g3dr] | --replay file.g3dr | --check-simd\n", argv[0]);
+            return 1;
+        }
+    }
+    if (checkSimd)
+        return checkEnemySimd(seed);
+
+    Replay replay;
+    if (replayPath) {
+        if (replayLoad(replayPath, &replay) != 0)
+            return 1;
+        ticks = replay.ticks;
+        seed = replay.seed;
+    }
+    else if (recordPath)
+        replayRecordStart(&replay, seed);
+    simInit(seed);
+
+    long games = 1, totalKills = 0, done = 0;
+    SimInput input = {0};
+    double t0 = now();
+    for (; done < ticks; done++) {
+        if (replayPath) {
+            if (!replayNext(&replay, &input))
+                break;
+        }
+        else {
+            int right = (done / BOT_TURN_TICKS) % 2;
+            input.left = !right;
+            input.right = (char)right;
+            input.fire = 1;
+            if (recordPath && replayRecord(&replay, &input) != 0) {
+                printf("Failed to record replay: out of memory\n");
+                return 1;
+            }
+        }
+        simTick(&input);
+        if (gameOver) {
+            if (replayPath || recordPath) { // Запись - одна игра
+                done++;
+                break;
+            }
+            totalKills += kills;
+            simInit(simSeed + 1);
+            games++;
+        }
+    }
+    double t = now() - t0;
+    totalKills += kills;
+    printf("%ld ticks (%.0f s of play) in %.3f s: %.0f ticks/s, %.0fx real time\n", done, done * (double)SIM_DT, t,
+           done / t, done * (double)SIM_DT / t);
+    printf("%ld games, %ld kills, last game: seed %llu, %d hits, %.1f s, state %016llx\n", games, totalKills,
+           (unsigned long long)simSeed, playerHits, simTicks * (double)SIM_DT, (unsigned long long)simStateHash());
+    if (bullets.dropped)
+        printf("%u shots dropped: bullet pool full (MAX_BULLETS %d)\n", bullets.dropped, MAX_BULLETS);
+    if (recordPath) {
+        if (replaySave(&replay, recordPath) != 0)
+            return 1;
+        printf("Recorded %u ticks to %s: %zu bytes\n", replay.ticks, recordPath, sizeof(ReplayHeader) + replay.size);
+    }
+    if (recordPath || replayPath)
+        replayFree(&replay);
+    return 0;
+}
@@ -6,152 +6,139 @@
 #include <math.h>
 #include <cglm/cglm.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
-
-#define BULLETTIME 0.70
-#define BULLETSPEED 0.01f
-#define MAX_BULLETS 100
-#define MAX_ENEMIES 30
-
-#define ENEMY_SIZEX 0.1f
-#define ENEMY_SIZEY 0.1f
-#define ENEMY_SIZEZ 0.05f
-#define ENEMY_SPEED 0.002f
-#define SCREEN_LIMIT_X 0.9f
-#define PLAYER_HITS_TO_DIE 10
-#define FORMATION_ROWS 3
-#define FORMATION_COLS 9
-#define H_SPACING 0.15f
-#define V_SPACING 0.2f
-#define DIVE_INTERVAL 7
-#define DIVE_SPEED 0.002f
-#define DIVE_ACCEL 0.00005f
-#define PLAYER_COLLIDE_RX 0.05f
-#define PLAYER_COLLIDE_RY 0.05f
-#define STARTPLY -0.4f
-
-const char *vertexShaderSource = "#version 330 core\n"
-                                 "layout (location = 0) in vec3 aPos;\n"
-                                 "layout (location = 1) in vec3 aColour;\n"
-                                 "uniform vec3 offset;\n"
-                                 "uniform mat4 model;\n"
-                                 "uniform mat4 view;\n"
-                                 "uniform mat4 projection;\n"
-                                 "out vec3 colour;\n"
-                                 "void main()\n"
-                                 "{\n"
-                                 "    gl_Position = projection*view*model*vec4(aPos + offset, 1.0);\n"
-                                 "    colour = aColour;\n"
-                                 "}\n";
-
-const char *fragmentShaderSource = "#version 330 core\n"
-                                   "in vec3 colour;\n"
-                                   "out vec4 FragColor;\n"
-                                   "uniform int isHit;\n"
-                                   "void main()\n"
-                                   "{\n"
-                                   "    if (isHit == 1)\n"
-                                   "        FragColor = vec4(1.0, 1.0, 1.0, 1.0);\n"
-                                   "    else\n"
-                                   "        FragColor = vec4(colour, 1.0f);\n"
-                                   "}\n";
-
-const char *primvetexshader = "#version 330 core\n"
-                              "layout (location = 0) in vec3 aPos;\n"
-                              "layout (location = 1) in vec2 aTexcoords;\n"
-                              "out vec2 Texcoords;\n"
-                              "void main()\n"
-                              "{\n"
-                              "    gl_Position = vec4(aPos, 1.0);\n"
-                              "    Texcoords = aTexcoords;\n"
-                              "}\n";
-const char *primefragmentshader = "#version 330 core\n"
-                                  "in vec2 Texcoords;\n"
-                                  "out vec4 FragColor;\n"
-                                  "uniform sampler2D texture1;\n"
-                                  "void main()\n"
-                                  "{\n"
-                                  "FragColor = texture(texture1, Texcoords);\n"
-                                  "}\n";
-const char *modelvertexShaderSource = "#version 330 core\n"
-                                 "layout (location = 0) in vec3 aPos;\n"
-                                 "layout (location = 1) in vec2 aTexCoords;\n"
-                                 "layout (location = 2) in vec3 aNormal;\n"
-                                 "uniform vec3 offset;\n"
-                                 "uniform mat4 model;\n"
-                                 "uniform mat4 view;\n"
-                                 "uniform mat4 projection;\n"
-                                 "out vec2 TexCoords;\n"
-                                 "out vec3 Normal;\n"
-                                 "out vec3 FragPos;\n"
-                                 "void main()\n"
-                                 "{\n"
-                                 "FragPos = vec3(model * vec4(aPos + offset, 1.0));\n"
-                                 "Normal = mat3(transpose(inverse(model))) * aNormal;\n"
-                                 "TexCoords = aTexCoords;\n"
-                                 "gl_Position = projection * view * vec4(FragPos, 1.0);\n"
-                                 "}\n";
-
-const char *modelfragmentShaderSource = "#version 330 core\n"
-                                   "in vec2 TexCoords;\n"
-                                   "in vec3 Normal;\n"
-                                   "in vec3 FragPos;\n"
-                                   "out vec4 FragColor;\n"
-                                   "uniform int isHit;\n"
-                                   "uniform sampler2D texture1;\n"
-                                   "void main()\n"
-                                   "{\n"
-                                   "    if (isHit == 1)\n"
-                                   "        FragColor = vec4(1.0, 1.0, 1.0, 1.0);\n"
-                                   "    else\n"
-                                   "        FragColor = texture(texture1, TexCoords);\n"
-                                   "}\n";
-
-
-float last_timebul = 0, last_enemy_shot = 0, lastDiveTime = 0;
-int playerHits = 0, kills = 0, playerIsHit = 0;
-
-
-typedef struct {
-    unsigned int vertexIndex;
-    unsigned int uvIndex;
-    unsigned int normalIndex;
-} Face;
-
-typedef struct {
-    vec3* vertices;
-    vec2* texCoords;
-    vec3* normals;
-    Face* faces;
-
-    unsigned int numVertices;
-    unsigned int numTexCoords;
-    unsigned int numNormals;
-    unsigned int numFaces;
-} Model;
-
-
-typedef struct Bullets
+#include "objload.h"
+#include "mesh.h"
+#include "meshopt.h"
+#include "texture.h"
+#include "assets.h"
+#include "upload.h"
+#include "archive.h"
+#include "cook.h"
+#include "watch.h"
+#include "progcache.h"
+#include "sim.h"
+#include "replay.h"
+
+#define MESH_OPTIMIZE_OVERDRAW 1 // Сортировка кластеров треугольников против перерисовки
+#define MESH_VERTEX_FORMAT MESH_FORMAT_PACKED // 16 байт на вершину вместо 32, MESH_FORMAT_FLOAT - без сжатия
+#define TEXTURE_COMPRESS 1 // Сжатые BC1/BC3 текстуры из .g3dt (готовятся texcook или при первом запуске)
+#define TEXTURE_MEMORY_BUDGET (24u * 1024 * 1024) // Байт на все текстуры; сверх него отбрасываются верхние мипы
+#define UPLOAD_FRAME_BYTES (4u * 1024 * 1024) // Байт загрузки в GPU за кадр, остальное - в следующих кадрах
+#define RES_DIR "../res/" // Каталог ресурсов относительно исполняемого файла
+#define ASSET_ARCHIVE "assets.g3da" // Архив рядом с исполняемым файлом (собирается assetpack)
+#define MESH_LOD_PIXELS 80.0f // Экранный диаметр (px), ниже которого берется следующий LOD; далее каждый вдвое меньше
+#define MESH_LOD_HYSTERESIS 0.1f // Запас против мерцания на границе уровней
+#ifndef EMBED_ASSETS
+#define EMBED_ASSETS 0 // 1 - ресурсы из архива, встроенного в программу: assetpack ../res assets.g3da --lz4 --embed
+#endif                 // embedded_assets.c, затем сборка с -DEMBED_ASSETS=1 и embedded_assets.c; каталог res не нужен
+#define HOT_RELOAD 1 // Слежение за файлами ресурсов и шейдеров и перезагрузка измененных на лету (только без архива)
+#define HOT_RELOAD_SETTLE 0.1 // Секунд без новых изменений перед перезагрузкой: файл может записываться в несколько приемов
+#define RENDER_VSYNC 1 // 0 - кадры без ожидания обновления экрана
+#define REPLAY_RECORD "last" REPLAY_EXT // Запись ввода каждой игры (рядом с исполняемым файлом); путь к записи первым аргументом проигрывает ее, headless --replay - без окна
+
+
+typedef struct // Текстура, подготовленная на рабочем потоке; в GL ее загружает finishTexture
 {
-    float x, y;
-    char dir;
-    struct Bullets* next;
-    struct Bullets* prev;
-} Bullet;
-typedef struct
+    const char* name;      // Имя в архиве и в каталоге ресурсов
+    char path[512];        // Путь к отдельному файлу, если в архиве записи нет
+    void* owned;           // Распакованная запись архива, на которую смотрит cache
+    TexCacheView cache;    // Сжатая текстура, если cache.header
+    unsigned char* pixels; // Иначе декодированное изображение
+    int width, height, channels;
+    size_t bytes; // Учтено в textureMemoryUsed
+} TextureAsset;
+typedef struct // Модель, подготовленная на рабочем потоке; в GL ее загружает finishModel
 {
-    float x, y, speedX, speedY;
-    int lives;
-    char active, diving, hit;
-} Enemy;
-
-Bullet* head = NULL;
-Bullet* tail = NULL;
-Enemy enemies[MAX_ENEMIES];
-
-void checkShaderCompileErrors(unsigned int shader)
+    const char* name;
+    char path[512];
+    void* owned;
+    float scale, zoffset, ydir, yoffset;
+    int change, keepCpuData;
+    Mesh mesh;
+    MeshCacheView cache;  // Готовые данные из кеша, если cache.header
+    PackedVertex* packed; // Иначе сжатые вершины (NULL - остались float) и индексы в формате GPU
+    void* indices;
+} ModelAsset;
+typedef struct // Исходник асета: отображенный файл или запись архива
+{
+    const void* data; // Для записи архива - только после sourceData
+    size_t size;
+    void* owned;  // Распакованная запись архива
+    int archived; // 0 - отображенный файл
+    int entry;
+    uint64_t hash;
+} AssetSource;
+
+#define HOT_IDLE 0
+#define HOT_LOADING 1   // Задача на пуле потоков
+#define HOT_UPLOADING 2 // Новые GL-объекты созданы, данные еще в очереди загрузки
+
+typedef struct // Текстура или модель, перезагружаемая при изменении файла: новые объекты готовятся рядом
+{              // со старыми и подменяются между кадрами, когда загрузка в GPU закончена
+    TextureAsset* texture; // Одно из двух
+    ModelAsset* model;
+    unsigned int* handle; // Текстура, с которой рисует кадр
+    Mesh* mesh;           // Модель, с которой рисует кадр, и ее буферы
+    unsigned int *VAO, *VBO, *EBO;
+    int dirty, state;
+    double start;
+    TextureAsset nextTexture;
+    ModelAsset nextModel;
+    unsigned int nextHandle;
+    Mesh nextMesh;
+    unsigned int nextVAO, nextVBO, nextEBO;
+} HotAsset;
+typedef struct // Программа из двух файлов шейдеров; при ошибке компиляции остается старая
+{
+    const char* vertex;
+    const char* fragment;
+    unsigned int* program;
+    int dirty;
+} HotProgram;
+typedef struct // Программа между beginProgram и endProgram
+{
+    const char* vertex;
+    const char* fragment;
+    unsigned int program, vs, fs;
+    uint64_t key;
+    char cachePath[600];
+    int cached; // Слинкована из бинарника
+} ProgramBuild;
+
+size_t textureMemoryUsed = 0; // Сумма по загруженным текстурам, для TEXTURE_MEMORY_BUDGET
+Archive assetArchive; // Отображенный архив ресурсов; пустой - ресурсы читаются из resDir
+char exeDir[480] = "./"; // Каталог исполняемого файла со слешем в конце
+char resDir[512] = RES_DIR;
+char programCacheDir[512] = RES_DIR; // Куда пишутся бинарники программ (COOK_DIR внутри); пустой - кеш выключен
+Uploader uploader; // Потоковая загрузка текстур и буферов через PBO
+int textureS3tc = 0; // Есть EXT_texture_compression_s3tc и включено TEXTURE_COMPRESS
+#if EMBED_ASSETS
+extern const unsigned char embeddedArchive[]; // embedded_assets.c
+extern const size_t embeddedArchiveSize;
+#endif
+Watcher watcher; // Изменения файлов для горячей перезагрузки
+HotAsset hotAssets[8];
+HotProgram hotPrograms[4];
+int numHotAssets = 0, numHotPrograms = 0;
+AssetScheduler reloadJobs; // Пул потоков для перезагрузки, пока reloadGroups
+int reloadGroups = 0, reloadAsset[ASSET_MAX_GROUPS];
+double lastFileChange = 0;
+unsigned char enemyLod[MAX_ENEMIES]; // Текущий LOD врага, только для отрисовки
+char enemyFlash[MAX_ENEMIES]; // Попадания с прошлого кадра: копятся после каждого тика, гасит отрисовка
+int playerFlash = 0;
+const float meshLodRatios[MESH_MAX_LODS] = {1.0f, 0.5f, 0.25f, 0.1f}; // Доля треугольников LOD0
+
+int checkShaderCompileErrors(unsigned int shader)
 {
     int success;
     char infoLog[512];
@@ -161,317 +148,107 @@ void checkShaderCompileErrors(unsigned int shader)
         glGetShaderInfoLog(shader, 512, NULL, infoLog);
         printf("ERROR::SHADER::COMPILATION_FAILED\n%s\n", infoLog);
     }
+    return success;
 }
-void delete_bullet(Bullet* cur_bullet){
-    if((cur_bullet->next == NULL) && (cur_bullet->prev == NULL)){
-        free(cur_bullet);
-        tail = NULL;
-        head = NULL;
-    }
-    else if(cur_bullet->prev == NULL){
-        cur_bullet->next->prev = NULL;
-        head = cur_bullet->next;
-        free(cur_bullet);
-    }
-    else if(cur_bullet->next == NULL){
-        cur_bullet->prev->next = NULL;
-        tail = cur_bullet->prev;
-        free(cur_bullet);
-    }
-    else{
-        cur_bullet->prev->next = cur_bullet->next;
-        cur_bullet->next-> prev = cur_bullet-> prev;
-        free(cur_bullet);
-    }
-}
-void shootBullet(float px)
-{
-    if ((glfwGetTime() - last_timebul) > 0.65)
-    {
-        Bullet* new_bullet = calloc(1,sizeof(Bullet));
-        if (!head){
-            head= new_bullet;
-            tail = head;
-            new_bullet->prev= NULL;
-        }
-        else{
-            tail->next = new_bullet;
-            new_bullet->prev = tail;
-            tail = new_bullet;
-        }
-        new_bullet->x = px;
-        new_bullet->y = STARTPLY + ENEMY_SIZEY;
-        new_bullet->dir = 1;
-        new_bullet->next = NULL;
-        last_timebul = glfwGetTime();
-    }
-}
-
-void updateBullets()
-{
-    if(!head){
-        return;
-    }
-    Bullet* cur_bullet = head;
-    Bullet * temp = NULL;
-    while(1)
-    {
-        temp = cur_bullet->next;
-            cur_bullet->y += BULLETSPEED*cur_bullet->dir;
-            if (fabsf(cur_bullet->y) > 1.0f)
-                delete_bullet(cur_bullet);
-        if(temp == NULL){
-            break;
-        }
-        cur_bullet = temp;
-    } 
-}
-
-void drawBullets(unsigned int prog, unsigned int VAO, mat4 model, mat4 view, mat4 projection)
+void drawBullets(unsigned int prog, unsigned int VAO, mat4 model, mat4 view, mat4 projection, float alpha)
 {
     glUseProgram(prog);
     glBindVertexArray(VAO);
     int off = glGetUniformLocation(prog, "offset");
-    Bullet* cur_bullet = head;
-    while(cur_bullet)
+    for (int i = 0; i < bullets.count; i++)
     {
-        
-        glUniform3f(off, cur_bullet->x, cur_bullet->y, 0.0f);
+        glUniform3f(off, bullets.x[i], bullets.prevY[i] + (bullets.y[i] - bullets.prevY[i]) * alpha, 0.0f);
         glUniformMatrix4fv(glGetUniformLocation(prog, "model"), 1, GL_FALSE, &model[0][0]);
         glUniformMatrix4fv(glGetUniformLocation(prog, "view"), 1, GL_FALSE, &view[0][0]);
         glUniformMatrix4fv(glGetUniformLocation(prog, "projection"), 1, GL_FALSE, &projection[0][0]);
         glDrawArrays(GL_TRIANGLES, 0, 6);
-        cur_bullet = cur_bullet->next;
-        
     }
 }
 
-void shootEnemyBullet(float ex, float ey, float interval)
-{
-   if ((glfwGetTime() - last_enemy_shot) > interval)
-    {
-        Bullet* new_bullet = calloc(1,sizeof(Bullet));
-        if (!head){
-            head= new_bullet;
-            tail = head;
-            new_bullet->prev= NULL;
-
-        }
-        else{
-            tail->next = new_bullet;
-            new_bullet->prev = tail;
-            tail = new_bullet;
-        }
-        
-        new_bullet->x = ex;
-        new_bullet->y = ey;
-        new_bullet->dir =-1;
-        new_bullet->next = NULL;
-        last_enemy_shot = glfwGetTime();
+// Параметры распаковки позиций для shaders/model.vert (для float вершин: 1 и 0)
+void setMeshDecode(unsigned int prog, const Mesh* mesh) {
+    if (mesh->vertexFormat == MESH_FORMAT_PACKED) {
+        glUniform3f(glGetUniformLocation(prog, "posScale"), mesh->boundsMax[0] - mesh->boundsMin[0],
+                    mesh->boundsMax[1] - mesh->boundsMin[1], mesh->boundsMax[2] - mesh->boundsMin[2]);
+        glUniform3fv(glGetUniformLocation(prog, "posBias"), 1, mesh->boundsMin);
+    } else {
+        glUniform3f(glGetUniformLocation(prog, "posScale"), 1.0f, 1.0f, 1.0f);
+        glUniform3f(glGetUniformLocation(prog, "posBias"), 0.0f, 0.0f, 0.0f);
     }
 }
 
-void updateEnemy()
-{
-    Bullet* cur_bullet = head;
-    Bullet* temp = NULL;
-    for (int j = 0; j < MAX_ENEMIES; j++)
-    {
-        cur_bullet = head;
-        if (enemies[j].active)
-        {
-            while (cur_bullet!=NULL)
-            {
-                temp = cur_bullet->next;
-                if ((fabs(cur_bullet->x - enemies[j].x) <= ENEMY_SIZEX) &&
-                    (fabs(cur_bullet->y - enemies[j].y) <= ENEMY_SIZEY) && (cur_bullet->dir == 1))
-                {
-                    enemies[j].lives--;
-                    delete_bullet(cur_bullet);
-                    enemies[j].hit = 1;
-                    if (enemies[j].lives == 0)
-                    {
-                        enemies[j].active = 0;
-                        kills++;
-                    }
-                }
-                cur_bullet = temp;
-            }
-        }
+// Уровни лежат в одном EBO друг за другом, рисуется диапазон со смещением
+void drawMeshLod(const Mesh* mesh, unsigned int lod) {
+    if (mesh->numLods == 0) {
+        glDrawElements(GL_TRIANGLES, mesh->numIndices, mesh->indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, 0);
+        return;
     }
+    if (lod >= mesh->numLods)
+        lod = mesh->numLods - 1;
+    glDrawElements(GL_TRIANGLES, mesh->lodCount[lod], mesh->indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+                   (const void*)((size_t)mesh->lodOffset[lod] * mesh->indexSize));
 }
 
-void spawnFormation()
-{
-    for (int r = 0; r < FORMATION_ROWS; r++)
-        for (int c = 0; c < FORMATION_COLS; c++)
-        {
-            int i = r * FORMATION_COLS + c;
-            enemies[i].x = -H_SPACING * (FORMATION_COLS - 1) / 2 + c * H_SPACING;
-            enemies[i].y = 0.8f - r * V_SPACING;
-            enemies[i].speedX = ENEMY_SPEED;
-            enemies[i].speedY = 0.0f;
-            enemies[i].lives = 2;
-            enemies[i].active = 1;
-            enemies[i].diving = 0;
-            enemies[i].hit = 0;
-        }
+void drawMesh(const Mesh* mesh) {
+    drawMeshLod(mesh, 0);
 }
 
-void updateEnemyMovement(float playerX)
-{
-    for (int j = 0; j < MAX_ENEMIES; j++)
-    {
-        if (enemies[j].active && !enemies[j].diving)
-        {
-            if (enemies[j].x + ENEMY_SIZEX >= SCREEN_LIMIT_X ||
-                enemies[j].x - ENEMY_SIZEX <= -SCREEN_LIMIT_X)
-            {
-                for (int k = 0; k < MAX_ENEMIES; k++)
-                {
-                    if (enemies[k].active && !enemies[k].diving)
-                    {
-                        enemies[k].speedX = -enemies[k].speedX;
-                    }
-                }
-                break;
-            }
-        }
-    }
-
-    for (int i = 0; i < MAX_ENEMIES; i++)
-    {
-        if (!enemies[i].active)
-            continue;
-
-        if (enemies[i].diving)
-        {
-            float dx = playerX - enemies[i].x;
-            float dy = STARTPLY - enemies[i].y;
-            float dist = sqrtf(dx * dx + dy * dy);
-            if (dist > 0.0f)
-            {
-                dx /= dist;
-                dy /= dist;
-                enemies[i].speedX += DIVE_ACCEL * dx;
-                enemies[i].speedY += DIVE_ACCEL * dy;
-            }
-            enemies[i].x += enemies[i].speedX;
-            enemies[i].y += enemies[i].speedY;
-
-            if (enemies[i].y < STARTPLY - 0.5f ||
-                enemies[i].x < -1.0f || enemies[i].x > 1.0f)
-            {
-
-                float deltaX = 0.0f;
-                float repInitX = 0.0f;
-                float repSpeed = ENEMY_SPEED;
-                for (int k = 0; k < MAX_ENEMIES; k++)
-                {
-                    if (enemies[k].active && !enemies[k].diving)
-                    {
-                        int c = k % FORMATION_COLS;
-                        repInitX = -H_SPACING * (FORMATION_COLS - 1) / 2 + c * H_SPACING;
-                        deltaX = enemies[k].x - repInitX;
-                        repSpeed = enemies[k].speedX;
-                        break;
-                    }
-                }
-
-                int r = i / FORMATION_COLS, c = i % FORMATION_COLS;
-                float initX = -H_SPACING * (FORMATION_COLS - 1) / 2 + c * H_SPACING;
-                enemies[i].x = initX + deltaX;
-                enemies[i].y = 0.8f - r * V_SPACING;
-                enemies[i].speedX = repSpeed;
-                enemies[i].speedY = 0.0f;
-                enemies[i].diving = 0;
-            }
-        }
-        else
-        {
-            enemies[i].x += enemies[i].speedX;
-        }
+// Экранный диаметр описанной сферы меша в пикселях при сдвиге offset
+float projectedSize(const Mesh* mesh, vec3 offset, mat4 model, mat4 view, mat4 projection, float viewportHeight) {
+    vec4 center, world, eye;
+    float radius = 0.0f;
+    for (int k = 0; k < 3; k++) {
+        float half = (mesh->boundsMax[k] - mesh->boundsMin[k]) * 0.5f;
+        center[k] = mesh->boundsMin[k] + half + offset[k];
+        radius += half * half;
     }
+    center[3] = 1.0f;
+    radius = sqrtf(radius);
+    glm_mat4_mulv(model, center, world);
+    glm_mat4_mulv(view, world, eye);
+    float depth = -eye[2];
+    if (depth <= radius)
+        return viewportHeight; // Камера внутри сферы
+    return 2.0f * radius * projection[1][1] / depth * viewportHeight * 0.5f;
 }
 
-void diveAttack(float px)
-{
-    if ((glfwGetTime() - lastDiveTime) < DIVE_INTERVAL)
-        return;
-    int start = (FORMATION_ROWS - 1) * FORMATION_COLS, end = start + FORMATION_COLS;
-    int cand[FORMATION_COLS], cnt = 0;
-    for (int i = start; i < end; i++)
-        if (enemies[i].active && !enemies[i].diving)
-            cand[cnt++] = i;
-    if (!cnt)
-        return;
-    int pick = cand[rand() % cnt];
-    float dx = px - enemies[pick].x, dy = STARTPLY - enemies[pick].y;
-    float len = sqrtf(dx * dx + dy * dy);
-    enemies[pick].speedX = DIVE_SPEED * dx / len;
-    enemies[pick].speedY = DIVE_SPEED * dy / len;
-    enemies[pick].diving = 1;
-    lastDiveTime = glfwGetTime();
-}
-
-void checkDiveCollisions(float playerX)
-{
-    for (int i = 0; i < MAX_ENEMIES; i++)
-    {
-        if (enemies[i].active && enemies[i].diving)
-        {
-            float dx = enemies[i].x - playerX;
-            float dy = enemies[i].y - STARTPLY;
-            if ((fabsf(dx) <= PLAYER_COLLIDE_RX + ENEMY_SIZEX) && (fabsf(dy) <= PLAYER_COLLIDE_RY + ENEMY_SIZEY))
-            {
-                playerHits++;
-                playerIsHit = 1;
-                enemies[i].lives = 0;
-                enemies[i].active = 0;
-                kills++;
-                enemies[i].diving = 0;
-                if (playerHits >= PLAYER_HITS_TO_DIE)
-                    exit(0);
-            }
-        }
+// Выбор LOD по экранному размеру; переход на соседний уровень только за пределами гистерезиса
+unsigned int selectLod(const Mesh* mesh, float pixels, unsigned int current) {
+    if (mesh->numLods <= 1)
+        return 0;
+    unsigned int lod = 0;
+    float threshold = MESH_LOD_PIXELS;
+    while (lod + 1 < mesh->numLods && pixels < threshold) {
+        lod++;
+        threshold *= 0.5f;
     }
-}
-
-void updatePlayerHits(float px)
-{
-    Bullet* cur_bullet = head;
-    Bullet* temp = NULL;
-    while(cur_bullet!=NULL)
-    {
-        temp =  cur_bullet->next;
-        if ((fabs(cur_bullet->x - px) <= PLAYER_COLLIDE_RX) &&
-            (fabs(cur_bullet->y - STARTPLY) <= PLAYER_COLLIDE_RY) && (cur_bullet->dir == -1))
-        {
-            playerHits++;
-            playerIsHit = 1;
-            delete_bullet(cur_bullet);
-            if (playerHits >= PLAYER_HITS_TO_DIE)
-            {
-                printf("Skill issue get good");
-                exit(0);
-            }
-        }
-        cur_bullet = temp;
+    if (current < mesh->numLods && current != lod) {
+        // Граница между current и lod: порог уровня min(current, lod)
+        unsigned int upper = current < lod ? current : lod;
+        float border = MESH_LOD_PIXELS;
+        for (unsigned int i = 0; i < upper; i++)
+            border *= 0.5f;
+        if (fabsf(pixels - border) < border * MESH_LOD_HYSTERESIS)
+            return current;
     }
+    return lod;
 }
 
-void drawEnemy(unsigned int prog, unsigned int VAO, Model* enemymodel, unsigned int texture, mat4 model, mat4 view, mat4 projection)
+void drawEnemy(unsigned int prog, unsigned int VAO, Mesh* enemymodel, unsigned int texture, mat4 model, mat4 view, mat4 projection, float viewportHeight, float alpha)
 {
     glUseProgram(prog);
     glBindVertexArray(VAO);
     int off = glGetUniformLocation(prog, "offset");
     int hitLoc = glGetUniformLocation(prog, "isHit");
+    setMeshDecode(prog, enemymodel);
     for (int i = 0; i < MAX_ENEMIES; i++)
     {
-        if (enemies[i].active)
+        if (ENEMY_BIT(enemies.active, i))
         {
-            glUniform3f(off, enemies[i].x, enemies[i].y, 0.0f);
-            glUniform1i(hitLoc, enemies[i].hit);
+            vec3 pos = {enemies.prevX[i] + (enemies.x[i] - enemies.prevX[i]) * alpha,
+                        enemies.prevY[i] + (enemies.y[i] - enemies.prevY[i]) * alpha, 0.0f};
+            glUniform3fv(off, 1, pos);
+            glUniform1i(hitLoc, enemyFlash[i]);
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, texture);
             glUniform1i(glGetUniformLocation(prog, "texture1"), 0);
@@ -479,25 +256,170 @@ void drawEnemy(unsigned int prog, unsigned int VAO, Model* enemymodel, unsigned
             glUniformMatrix4fv(glGetUniformLocation(prog, "view"), 1, GL_FALSE, &view[0][0]);
             glUniformMatrix4fv(glGetUniformLocation(prog, "projection"), 1, GL_FALSE, &projection[0][0]);
             glBindVertexArray(VAO);
-            glDrawArrays(GL_TRIANGLES, 0, enemymodel->numFaces);
-            enemies[i].hit = 0;
+            enemyLod[i] = selectLod(enemymodel, projectedSize(enemymodel, pos, model, view, projection, viewportHeight), enemyLod[i]);
+            drawMeshLod(enemymodel, enemyLod[i]);
+            enemyFlash[i] = 0;
         }
     }
 }
 
-void processInput(GLFWwindow *w, float *x) // Обработка ввода
+SimInput processInput(GLFWwindow *w) // Обработка ввода, раз в кадр
 {
     if (glfwGetKey(w, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(w, 1);
-    if (glfwGetKey(w, GLFW_KEY_LEFT) == GLFW_PRESS && *x > -SCREEN_LIMIT_X)
-        *x -= 0.01f;
-    if (glfwGetKey(w, GLFW_KEY_RIGHT) == GLFW_PRESS && *x < SCREEN_LIMIT_X)
-        *x += 0.01f;
-    if (glfwGetKey(w, GLFW_KEY_SPACE) == GLFW_PRESS)
-        shootBullet(*x);
+    SimInput in;
+    in.left = glfwGetKey(w, GLFW_KEY_LEFT) == GLFW_PRESS;
+    in.right = glfwGetKey(w, GLFW_KEY_RIGHT) == GLFW_PRESS;
+    in.fire = glfwGetKey(w, GLFW_KEY_SPACE) == GLFW_PRESS;
+    return in;
+}
+
+// Форматы EXT_texture_compression_s3tc (в glad их нет)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+int hasGlExtension(const char* name) {
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (int i = 0; i < count; i++) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && strcmp(ext, name) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// Учет памяти текстуры и строка отчета при запуске
+void reportTexture(const char* path, unsigned int width, unsigned int height, const char* format, size_t bytes, unsigned int dropped) {
+    textureMemoryUsed += bytes;
+    printf("%s: %ux%u %s, %.2f MB", path, width, height, format, bytes / (1024.0 * 1024.0));
+    if (dropped)
+        printf(", %u top mips dropped for budget", dropped);
+    printf(" (textures %.2f / %.2f MB)\n", textureMemoryUsed / (1024.0 * 1024.0), TEXTURE_MEMORY_BUDGET / (1024.0 * 1024.0));
+}
+
+// Мип-уровни сжатой текстуры прямо из отображенного кеша, без декодирования и glGenerateMipmap.
+// Уровни уходят через PBO от меньшего к большему, базовый уровень опускается по мере загрузки.
+// Если текстура не влезает в бюджет, верхние уровни пропускаются. release освобождает кеш после последнего уровня
+void uploadCompressedTexture(unsigned int texture, const char* path, const TexCacheView* cache, void (*release)(void*), void* ctx) {
+    const TexCacheHeader* h = cache->header;
+    unsigned int glFormat = h->format == TEXTURE_FORMAT_BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    size_t total = 0, offsets[TEXCACHE_MAX_MIPS];
+    for (unsigned int l = 0; l < h->numMips; l++) {
+        offsets[l] = total;
+        total += h->mipSize[l];
+    }
+    unsigned int drop = 0;
+    while (drop + 1 < h->numMips && textureMemoryUsed + total > TEXTURE_MEMORY_BUDGET)
+        total -= h->mipSize[drop++];
+    unsigned int levels = h->numMips - drop;
+
+    // Память под все уровни сразу, данные - потом
+    for (unsigned int l = 0; l < levels; l++) {
+        unsigned int w = h->width >> (l + drop), hgt = h->height >> (l + drop);
+        glCompressedTexImage2D(GL_TEXTURE_2D, l, glFormat, w ? w : 1, hgt ? hgt : 1, 0, h->mipSize[l + drop], NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    for (int l = levels - 1; l >= 0; l--) {
+        unsigned int w = h->width >> (l + drop), hgt = h->height >> (l + drop);
+        w = w ? w : 1;
+        hgt = hgt ? hgt : 1;
+        UploadJob job = {texture, l, glFormat, 1, w, hgt, compressedMipSize(h->format, w, 1), 4,
+                         cache->data + offsets[l + drop], h->mipSize[l + drop], 0, l, l == 0 ? release : NULL, ctx};
+        uploaderQueue(&uploader, &job);
+    }
+    reportTexture(path, h->width >> drop ? h->width >> drop : 1, h->height >> drop ? h->height >> drop : 1,
+                  h->format == TEXTURE_FORMAT_BC3 ? "BC3" : "BC1", total, drop);
+}
+
+// Запись архива по имени; распакованный буфер (если запись сжата) - в *owned. NULL - записи нет
+const void* findAsset(const char* name, size_t* size, void** owned) {
+    int entry = archiveFind(&assetArchive, name);
+    *owned = NULL;
+    return entry >= 0 ? archiveData(&assetArchive, entry, size, owned) : NULL;
+}
+
+// Исходник асета и хеш его содержимого для ключа готовки. Хеш записи архива берется из оглавления,
+// сама запись читается (и распаковывается) только в sourceData, если готового результата нет
+int openSource(const char* name, const char* path, AssetSource* src) {
+    memset(src, 0, sizeof(*src));
+    src->entry = archiveFind(&assetArchive, name);
+    src->archived = src->entry >= 0;
+    if (src->archived) {
+        src->size = (size_t)assetArchive.entries[src->entry].rawSize;
+        src->hash = assetArchive.entries[src->entry].contentHash;
+        return 0;
+    }
+    if (mapFile(path, &src->data, &src->size) != 0)
+        return -1;
+    src->hash = hashContent(src->data, src->size);
+    return 0;
+}
+
+const void* sourceData(AssetSource* src) {
+    if (!src->data && src->archived)
+        src->data = archiveData(&assetArchive, src->entry, &src->size, &src->owned);
+    return src->data;
+}
+
+void closeSource(AssetSource* src) {
+    if (!src->archived)
+        unmapFile(src->data, src->size);
+    free(src->owned);
+    memset(src, 0, sizeof(*src));
+}
+
+// Рабочий поток: готовая сжатая текстура по хешу исходника (если ее нет - готовится сейчас), при неудаче
+// декодирование stb. Из архива - то же, но без готовки: архив только читается
+void decodeTexture(void* arg) {
+    TextureAsset* t = arg;
+    snprintf(t->path, sizeof(t->path), "%s%s", resDir, t->name);
+    AssetSource src;
+    if (openSource(t->name, t->path, &src) != 0) {
+        printf("Failed to load texture: %s\n", t->path);
+        return;
+    }
+    if (textureS3tc) {
+        char cooked[64], cookedPath[600];
+        cookName(cooked, sizeof(cooked), textureCookKey(src.hash), TEXCACHE_EXT);
+        snprintf(cookedPath, sizeof(cookedPath), "%s%s", resDir, cooked);
+        size_t size;
+        const void* data = src.archived ? findAsset(cooked, &size, &t->owned) : NULL;
+        int ready = src.archived ? data && viewTextureCache(data, size, src.hash, src.size, &t->cache)
+                                 : mapTextureCache(cookedPath, src.hash, src.size, &t->cache) ||
+                                   (cookTexture(src.data, src.size, src.hash, cookedPath) == 0 &&
+                                    mapTextureCache(cookedPath, src.hash, src.size, &t->cache));
+        if (ready) {
+            closeSource(&src);
+            return;
+        }
+        free(t->owned);
+        t->owned = NULL;
+    }
+    const void* data = sourceData(&src);
+    t->pixels = data && src.size <= INT_MAX ? stbi_load_from_memory(data, (int)src.size, &t->width, &t->height, &t->channels, 0) : NULL;
+    closeSource(&src);
+    if (!t->pixels)
+        printf("Failed to load texture %s: %s\n", t->name, stbi_failure_reason());
 }
 
-unsigned int loadTexture(const char *path)
+// Исходные данные текстуры больше не нужны: все куски уже скопированы в PBO
+void releaseTextureAsset(void* ctx) {
+    TextureAsset* t = ctx;
+    unmapTextureCache(&t->cache);
+    free(t->owned);
+    t->owned = NULL;
+    free(t->pixels); // stbi_image_free - это free, после уменьшения буфер уже наш
+    t->pixels = NULL;
+}
+
+// Поток GL: создание текстуры и постановка данных в очередь загрузки; асет должен жить до ее конца
+unsigned int finishTexture(TextureAsset* t)
 {
     unsigned int texture;
     glGenTextures(1, &texture);
@@ -508,160 +430,541 @@ unsigned int loadTexture(const char *path)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    int width, height, nrChannels;
-    unsigned char *data = stbi_load(path, &width, &height, &nrChannels, 0);
+    size_t used = textureMemoryUsed;
+    if (t->cache.header) {
+        uploadCompressedTexture(texture, t->name, &t->cache, releaseTextureAsset, t);
+        t->bytes = textureMemoryUsed - used;
+        return texture;
+    }
+
+    int width = t->width, height = t->height, nrChannels = t->channels;
+    unsigned char *data = t->pixels;
+    t->pixels = NULL;
     if (data)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        // Формат по числу каналов: серый и серый+альфа размножаются swizzle, как было при GL_RGBA
+        static const int internalFormats[4] = {GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+        static const unsigned int formats[4] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+        static const char* names[4] = {"R8", "RG8", "RGB8", "RGBA8"};
+        int c = nrChannels - 1;
+        if (nrChannels == 1 || nrChannels == 2) {
+            int swizzle[4] = {GL_RED, GL_RED, GL_RED, nrChannels == 2 ? GL_GREEN : GL_ONE};
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        }
+
+        // Сверх бюджета изображение уменьшается вдвое, пока не влезет (то же, что отбросить верхний мип)
+        unsigned int dropped = 0;
+        while ((width > 1 || height > 1) &&
+               textureMemoryUsed + textureChainSize(width, height, nrChannels) > TEXTURE_MEMORY_BUDGET) {
+            unsigned char* half = malloc((size_t)(width > 1 ? width / 2 : 1) * (height > 1 ? height / 2 : 1) * nrChannels);
+            if (!half)
+                break;
+            downsampleImage(data, width, height, nrChannels, half);
+            stbi_image_free(data);
+            data = half;
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+            dropped++;
+        }
+
+        // Уровень 0 строками через PBO (строки RGB/R/RG не выровнены на 4 байта - это учитывает загрузчик),
+        // мипы - glGenerateMipmap после последней строки
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[c], width, height, 0, formats[c], GL_UNSIGNED_BYTE, NULL);
+        t->pixels = data;
+        UploadJob job = {texture, 0, formats[c], 0, width, height, (size_t)width * nrChannels, 1,
+                         data, (size_t)width * height * nrChannels, 0, UPLOAD_GENERATE_MIPS, releaseTextureAsset, t};
+        uploaderQueue(&uploader, &job);
+        reportTexture(t->name, width, height, names[c], textureChainSize(width, height, nrChannels), dropped);
+        t->bytes = textureMemoryUsed - used;
     }
     else
     {
-        printf("Failed to load texture: %s\n", stbi_failure_reason());
         return -1;
     }
-    stbi_image_free(data);
     return texture;
 }
 
-void loadObj(const char* path, Model* obmodel, float scale, float zoffset, float ydir, float yoffset, int change) {
-    FILE* file = fopen(path, "r");
-    if (!file) {
-        printf("Failed to open OBJ file: %s\n", path);
+unsigned int loadTexture(const char *name)
+{
+    TextureAsset t;
+    memset(&t, 0, sizeof(t));
+    t.name = name;
+    decodeTexture(&t);
+    unsigned int texture = finishTexture(&t);
+    uploaderFlush(&uploader);
+    return texture;
+}
+
+// Буферы создаются сразу, данные идут через очередь загрузки; release - после последнего куска индексов.
+// immediate - данные копируются сразу и буферы готовы к отрисовке по возвращении (меш рисуется в том же кадре)
+void uploadMesh(const void* vertexData, unsigned int numVertices, unsigned int vertexFormat, const void* indexData, unsigned int numIndices, unsigned int indexSize, unsigned int* VAO, unsigned int* VBO, unsigned int* EBO, void (*release)(void*), void* ctx, int immediate) {
+    glGenVertexArrays(1, VAO);
+    glGenBuffers(1, VBO);
+    glGenBuffers(1, EBO);
+    glBindVertexArray(*VAO);
+
+    // Загрузка данных вершин в VBO и индексов в EBO
+    unsigned int stride = meshVertexStride(vertexFormat);
+    glBindBuffer(GL_ARRAY_BUFFER, *VBO);
+    glBufferData(GL_ARRAY_BUFFER, (size_t)numVertices * stride, immediate ? vertexData : NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)numIndices * indexSize, immediate ? indexData : NULL, GL_STATIC_DRAW);
+    if (immediate) {
+        if (release)
+            release(ctx);
+    } else { // Рисовать можно только после последнего куска: до того в буферах неопределенные данные
+        UploadJob vertices = {*VBO, -1, 0, 0, 0, 0, 0, 0, vertexData, (size_t)numVertices * stride, 0, UPLOAD_KEEP_BASE, NULL, NULL};
+        UploadJob indices = {*EBO, -1, 0, 0, 0, 0, 0, 0, indexData, (size_t)numIndices * indexSize, 0, UPLOAD_KEEP_BASE, release, ctx};
+        uploaderQueue(&uploader, &vertices);
+        uploaderQueue(&uploader, &indices);
+    }
+    if (vertexFormat == MESH_FORMAT_PACKED) { // unorm16 позиция, half UV, snorm 2_10_10_10 нормаль
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, pos));
+        glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, uv));
+        glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal));
+    } else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(5 * sizeof(float)));
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+
+    glBindVertexArray(0);
+}
+
+// Сборка индексированного меша из модели, оптимизация порядка, LOD и сжатие вершин (без GL).
+// *packed - сжатые вершины, если сжатие принято, иначе NULL и вершины остаются float
+int prepareMesh(const char* name, const Model* model, Mesh* mesh, PackedVertex** packed) {
+    *packed = NULL;
+    if (buildMesh(model, mesh) != 0)
+        return -1;
+    MeshCacheStats before = {0.0f, 0.0f}, after = {0.0f, 0.0f};
+    if (optimizeMesh(mesh, MESH_OPTIMIZE_OVERDRAW, &before, &after) != 0)
+        printf("Mesh optimization failed: %s\n", name);
+    printf("%s: %u -> %u vertices after deduplication, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", name,
+           mesh->numIndices, mesh->numVertices, before.acmr, after.acmr, before.atvr, after.atvr);
+
+    // Цепочка LOD поверх оптимизированного LOD0, допуск ошибки от диагонали AABB
+    float diag = 0.0f;
+    for (int k = 0; k < 3; k++)
+        diag += (mesh->boundsMax[k] - mesh->boundsMin[k]) * (mesh->boundsMax[k] - mesh->boundsMin[k]);
+    if (generateMeshLods(mesh, meshLodRatios, MESH_MAX_LODS, MESHOPT_LOD_MAX_ERROR * sqrtf(diag)) != 0)
+        printf("LOD generation failed: %s\n", name);
+    for (unsigned int l = 0; l < mesh->numLods; l++)
+        printf("%s: LOD%u %u triangles\n", name, l, mesh->lodCount[l] / 3);
+
+    // Сжатый формат, если ошибка относительно float в допуске
+    mesh->vertexFormat = MESH_FORMAT_FLOAT;
+    if (MESH_VERTEX_FORMAT == MESH_FORMAT_PACKED && (*packed = packMeshVertices(mesh))) {
+        MeshPackError err = measurePackError(mesh, *packed);
+        printf("%s: packed vertices, max error pos %.2g (of AABB), uv %.2g, normal %.3f deg\n", name, err.pos,
+               err.uv, err.normalDeg);
+        if (packErrorAcceptable(&err)) {
+            mesh->vertexFormat = MESH_FORMAT_PACKED;
+        } else {
+            printf("%s: packing error above threshold, keeping float vertices\n", name);
+            free(*packed);
+            *packed = NULL;
+        }
+    }
+    return 0;
+}
+
+// Рабочий поток: сначала готовый меш по хешу исходника и параметрам, OBJ только если его нет.
+// Из архива готовый меш не пишется - архив только читается
+void prepareModel(void* arg) {
+    ModelAsset* a = arg;
+    memset(&a->mesh, 0, sizeof(a->mesh));
+    snprintf(a->path, sizeof(a->path), "%s%s", resDir, a->name);
+    AssetSource src;
+    if (openSource(a->name, a->path, &src) != 0) {
+        printf("Failed to load model: %s\n", a->path);
         return;
     }
+    char cooked[64], cookedPath[600];
+    // Параметры готовки те же, что передает prepareMesh
+    uint64_t key = meshCookKey(src.hash, a->scale, a->zoffset, a->ydir, a->yoffset, a->change, MESH_VERTEX_FORMAT,
+                               MESH_OPTIMIZE_OVERDRAW, meshLodRatios, MESHOPT_LOD_MAX_ERROR);
+    cookName(cooked, sizeof(cooked), key, MESHCACHE_EXT);
+    snprintf(cookedPath, sizeof(cookedPath), "%s%s", resDir, cooked);
+    if (!a->keepCpuData) {
+        size_t size;
+        const void* data = src.archived ? findAsset(cooked, &size, &a->owned) : NULL;
+        int ready = src.archived ? data && viewMeshCache(data, size, src.hash, src.size, a->scale, a->zoffset, a->ydir,
+                                                         a->yoffset, a->change, MESH_VERTEX_FORMAT, &a->cache)
+                                 : mapMeshCache(cookedPath, src.hash, src.size, a->scale, a->zoffset, a->ydir, a->yoffset,
+                                                a->change, MESH_VERTEX_FORMAT, &a->cache);
+        if (ready) {
+            closeSource(&src);
+            return;
+        }
+        free(a->owned);
+        a->owned = NULL;
+    }
+    Model obmodel;
+    memset(&obmodel, 0, sizeof(Model));
+    const void* data = sourceData(&src);
+    if (!data || parseObjParallel(data, src.size, &obmodel, a->scale, a->zoffset, a->ydir, a->yoffset, a->change, 0) != 0)
+        printf("Failed to load model: %s\n", a->path);
+    if (prepareMesh(a->name, &obmodel, &a->mesh, &a->packed) == 0 && a->mesh.numIndices && !src.archived)
+        saveMeshCache(cookedPath, src.hash, src.size, &a->mesh, MESH_VERTEX_FORMAT, a->scale, a->zoffset, a->ydir, a->yoffset, a->change);
+    closeSource(&src);
+    freeModel(&obmodel);
+    a->indices = packMeshIndices(&a->mesh);
+}
 
-    unsigned int maxVertices = 100000, maxTexCoords = 100000, maxNormals = 100000, maxFaces = 100000;
-    obmodel->vertices = malloc(maxVertices * sizeof(vec3));
-    obmodel->texCoords = malloc(maxTexCoords * sizeof(vec2));
-    obmodel->normals = malloc(maxNormals * sizeof(vec3));
-    obmodel->faces = malloc(maxFaces * sizeof(Face));
-
-    int y = 1;
-    int z = 2;
-    if(change){ // Если перепутаны y и z
-        z=1;
-        y=2;
-    }
-    char line[512];
-    int offset = 0;
-    while (fgets(line, sizeof(line), file)) {
-        char*ind = line;
-        if (strncmp(line, "v ", 2) == 0) {
-            sscanf(line, "v %f %f %f", &(obmodel->vertices[obmodel->numVertices])[0],
-                   &(obmodel->vertices[obmodel->numVertices])[y],
-                   &(obmodel->vertices[obmodel->numVertices])[z]);
-
-            obmodel->vertices[obmodel->numVertices][0] *= scale; // Смещения и масштаб
-            obmodel->vertices[obmodel->numVertices][z] *= scale;
-            obmodel->vertices[obmodel->numVertices][y] *= (scale*ydir);
-            obmodel->vertices[obmodel->numVertices][1] += zoffset;
-            obmodel->vertices[obmodel->numVertices][1] += yoffset;
-
-            obmodel->numVertices++;
-        } else if (strncmp(line, "vt ", 3) == 0) {
-            // Текстурная координата
-            sscanf(line, "vt %f %f", &obmodel->texCoords[obmodel->numTexCoords][0],
-                   &obmodel->texCoords[obmodel->numTexCoords][1]);
-            obmodel->numTexCoords++;
-        } else if (strncmp(line, "vn ", 3) == 0) {
-            // Нормаль
-            sscanf(line, "vn %f %f %f", &obmodel->normals[obmodel->numNormals][0],
-                   &obmodel->normals[obmodel->numNormals][1],
-                   &obmodel->normals[obmodel->numNormals][2]);
-            obmodel->numNormals++;
-        } else if (strncmp(line, "f ", 2) == 0) {
-            // Грань
-            unsigned int v[3], vt[3], vn[3];
-            int result = sscanf(ind, "f %u/%u/%u %u/%u/%u %u/%u/%u%n",
-                                &v[0], &vt[0], &vn[0],
-                                &v[1], &vt[1], &vn[1],
-                                &v[2], &vt[2], &vn[2],&offset);
-            ind+=offset;
-            offset = 0;
-            for (int i = 0; i < 3; i++) { // Сборка полигонов (если после 3 вершин есть что то еще, создается несколько треугольников)
-                obmodel->faces[obmodel->numFaces].vertexIndex = v[i] - 1;
-                obmodel->faces[obmodel->numFaces].uvIndex = vt[i] - 1;
-                obmodel->faces[obmodel->numFaces].normalIndex = vn[i] - 1;
-                obmodel->numFaces++;
-            }
-            while(sscanf(ind, "%u/%u/%u%n", &v[1], &vt[1], &vn[1],&offset) == 3){
-                obmodel->faces[obmodel->numFaces].vertexIndex = v[0] - 1;
-                obmodel->faces[obmodel->numFaces].uvIndex = vt[0] - 1;
-                obmodel->faces[obmodel->numFaces].normalIndex = vn[0] - 1;
-                obmodel->numFaces++;
-                obmodel->faces[obmodel->numFaces].vertexIndex = v[2] - 1;
-                obmodel->faces[obmodel->numFaces].uvIndex = vt[2] - 1;
-                obmodel->faces[obmodel->numFaces].normalIndex = vn[2] - 1;
-                obmodel->numFaces++;
-                obmodel->faces[obmodel->numFaces].vertexIndex = v[1] - 1;
-                obmodel->faces[obmodel->numFaces].uvIndex = vt[1] - 1;
-                obmodel->faces[obmodel->numFaces].normalIndex = vn[1] - 1;
-                obmodel->numFaces++;
-                v[2] = v[1];
-                vt[2] = vt[1];
-                vn[2] = vn[1];
-                ind+=offset;
-                offset = 0;
-            }
+// Данные модели больше не нужны: вершины и индексы уже скопированы в PBO
+void releaseModelAsset(void* ctx) {
+    ModelAsset* a = ctx;
+    unmapMeshCache(&a->cache);
+    free(a->owned);
+    a->owned = NULL;
+    if (a->indices != a->mesh.indices)
+        free(a->indices);
+    free(a->packed);
+    a->indices = NULL;
+    a->packed = NULL;
+    if (!a->keepCpuData)
+        freeMeshData(&a->mesh);
+}
+
+// Поток GL: VAO/VBO/EBO и данные - сразу (immediate) или через очередь загрузки; во втором случае асет должен
+// жить до ее конца, а меш рисоваться только после. CPU-копия меша остается только при keepCpuData (из кеша ее нет вовсе)
+void finishModel(ModelAsset* a, Mesh* mesh, unsigned int* VAO, unsigned int* VBO, unsigned int* EBO, int immediate) {
+    if (a->cache.header) {
+        const MeshCacheHeader* h = a->cache.header;
+        memset(mesh, 0, sizeof(*mesh));
+        mesh->numVertices = h->numVertices;
+        mesh->numIndices = h->numIndices;
+        mesh->indexSize = h->indexSize;
+        mesh->vertexFormat = h->vertexFormat;
+        mesh->numLods = h->numLods;
+        for (unsigned int l = 0, offset = 0; l < h->numLods; offset += h->lodCount[l], l++) {
+            mesh->lodOffset[l] = offset;
+            mesh->lodCount[l] = h->lodCount[l];
         }
+        memcpy(mesh->boundsMin, h->boundsMin, sizeof(h->boundsMin));
+        memcpy(mesh->boundsMax, h->boundsMax, sizeof(h->boundsMax));
+        uploadMesh(a->cache.vertices, h->numVertices, h->vertexFormat, a->cache.indices, h->numIndices, h->indexSize,
+                   VAO, VBO, EBO, releaseModelAsset, a, immediate);
+        return;
     }
+    *mesh = a->mesh;
+    if (!a->keepCpuData) { // Массивы принадлежат асету до releaseModelAsset
+        mesh->vertices = NULL;
+        mesh->indices = NULL;
+    }
+    uploadMesh(a->packed ? (const void*)a->packed : a->mesh.vertices, mesh->numVertices, mesh->vertexFormat, a->indices,
+               a->indices ? mesh->numIndices : 0, mesh->indexSize, VAO, VBO, EBO, releaseModelAsset, a, immediate);
+}
 
-    fclose(file);
+void loadModel(const char* name, Mesh* mesh, float scale, float zoffset, float ydir, float yoffset, int change, unsigned int* VAO, unsigned int* VBO, unsigned int* EBO, int keepCpuData) {
+    ModelAsset a;
+    memset(&a, 0, sizeof(a));
+    a.name = name;
+    a.scale = scale;
+    a.zoffset = zoffset;
+    a.ydir = ydir;
+    a.yoffset = yoffset;
+    a.change = change;
+    a.keepCpuData = keepCpuData;
+    prepareModel(&a);
+    finishModel(&a, mesh, VAO, VBO, EBO, 1);
 }
 
-void freeModel(Model* obmodel) {
-    free(obmodel->vertices);
-    free(obmodel->texCoords);
-    free(obmodel->normals);
-    free(obmodel->faces);
+// Встроенный архив, если программа собрана с ним. Иначе архив и каталог ресурсов ищутся от исполняемого файла,
+// поэтому игра запускается из любого каталога
+void openAssets() {
+    char exe[480];
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    char* slash = n > 0 ? (exe[n] = 0, strrchr(exe, '/')) : NULL;
+    if (slash) { // Иначе остаются пути относительно текущего каталога
+        slash[1] = 0;
+        strcpy(exeDir, exe);
+        snprintf(resDir, sizeof(resDir), "%s%s", exeDir, RES_DIR);
+    }
+    // С архивом каталога ресурсов может не быть: тогда кеш программ - рядом с исполняемым файлом, если туда можно писать
+    struct stat st;
+    const char* cacheDir = stat(resDir, &st) == 0 && S_ISDIR(st.st_mode) ? resDir : exeDir;
+    snprintf(programCacheDir, sizeof(programCacheDir), "%s", access(cacheDir, W_OK) == 0 ? cacheDir : "");
+    if (!programCacheDir[0])
+        printf("Program binary cache disabled: %s is not writable\n", cacheDir);
+#if EMBED_ASSETS
+    if (openArchiveMemory(embeddedArchive, embeddedArchiveSize, &assetArchive) == 0) {
+        printf("Using embedded assets (%u entries)\n", assetArchive.header->numEntries);
+        return;
+    }
+    printf("Invalid embedded asset archive\n");
+#endif
+    if (!slash)
+        return;
+    char archivePath[600];
+    snprintf(archivePath, sizeof(archivePath), "%s%s", exeDir, ASSET_ARCHIVE);
+    if (openArchive(archivePath, &assetArchive) == 0)
+        printf("Using asset archive %s (%u entries)\n", archivePath, assetArchive.header->numEntries);
+}
 
-    obmodel->numVertices = 0;
-    obmodel->numTexCoords = 0;
-    obmodel->numNormals = 0;
-    obmodel->numFaces = 0;
+// Исходник шейдера из архива или resDir. 0 при успехе
+int openShader(const char* name, AssetSource* src) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s%s", resDir, name);
+    if (openSource(name, path, src) != 0) {
+        printf("Failed to load shader: %s\n", path);
+        return -1;
+    }
+    if (src->size == 0 || src->size > INT_MAX || !sourceData(src)) {
+        printf("Failed to load shader: %s\n", path);
+        closeSource(src);
+        return -1;
+    }
+    return 0;
 }
 
-void setupModelBuffers(Model* model, unsigned int* VAO, unsigned int* VBO) {
-    glGenVertexArrays(1, VAO);
-    glGenBuffers(1, VBO);
-    glBindVertexArray(*VAO);
+// Компиляция без проверки результата: с параллельной компиляцией драйвер не ждет ее здесь
+unsigned int compileShader(unsigned int type, const AssetSource* src) {
+    const char* text = src->data;
+    int length = (int)src->size;
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &text, &length);
+    glCompileShader(shader);
+    return shader;
+}
 
-    float* vertexData = malloc(model->numFaces * 3 * 8 * sizeof(float)); // 8 = 3 (позиция) + 2 (текстура) + 3 (нормаль)
-    unsigned int index = 0;
-    for (unsigned int i = 0; i < model->numFaces; i++) {
-        Face face = model->faces[i];
+// Программа из кеша бинарников, если он есть для этих исходников и драйвера, иначе компиляция и линковка.
+// Результат забирает endProgram, между ними поток GL свободен для другой работы
+void beginProgram(ProgramBuild* b, const char* vertexName, const char* fragmentName) {
+    memset(b, 0, sizeof(*b));
+    b->vertex = vertexName;
+    b->fragment = fragmentName;
+    AssetSource vs, fs;
+    if (openShader(vertexName, &vs) != 0)
+        return;
+    if (openShader(fragmentName, &fs) != 0) {
+        closeSource(&vs);
+        return;
+    }
+    b->key = programCacheKey(vs.data, vs.size, fs.data, fs.size);
+    char cooked[64];
+    cookName(cooked, sizeof(cooked), b->key, PROGCACHE_EXT);
+    if (programCacheDir[0])
+        snprintf(b->cachePath, sizeof(b->cachePath), "%s%s", programCacheDir, cooked);
+    b->program = glCreateProgram();
+    b->cached = b->cachePath[0] && loadProgramBinary(b->cachePath, b->key, b->program);
+    if (!b->cached) {
+        b->vs = compileShader(GL_VERTEX_SHADER, &vs);
+        b->fs = compileShader(GL_FRAGMENT_SHADER, &fs);
+        glAttachShader(b->program, b->vs);
+        glAttachShader(b->program, b->fs);
+        programBinaryHint(b->program);
+        glLinkProgram(b->program);
+    }
+    closeSource(&vs);
+    closeSource(&fs);
+}
 
-        // Позиция
-        vertexData[index++] = model->vertices[face.vertexIndex][0];
-        vertexData[index++] = model->vertices[face.vertexIndex][1];
-        vertexData[index++] = model->vertices[face.vertexIndex][2];
+// Проверка компиляции и линковки (здесь поток GL ждет драйвер) и сохранение бинарника. 0 - ошибка
+unsigned int endProgram(ProgramBuild* b) {
+    if (b->cached || !b->program)
+        return b->program;
+    int vsOk = checkShaderCompileErrors(b->vs), fsOk = checkShaderCompileErrors(b->fs), linked = 0;
+    if (!vsOk || !fsOk)
+        printf("Failed to compile shader: %s\n", vsOk ? b->fragment : b->vertex);
+    glGetProgramiv(b->program, GL_LINK_STATUS, &linked);
+    if (vsOk && fsOk && !linked) {
+        char infoLog[512];
+        glGetProgramInfoLog(b->program, sizeof(infoLog), NULL, infoLog);
+        printf("Failed to link program %s + %s:\n%s\n", b->vertex, b->fragment, infoLog);
+    }
+    if (linked) {
+        if (b->cachePath[0])
+            saveProgramBinary(b->cachePath, b->key, b->program);
+    } else {
+        glDeleteProgram(b->program);
+        b->program = 0;
+    }
+    glDeleteShader(b->vs);
+    glDeleteShader(b->fs);
+    b->vs = b->fs = 0;
+    return b->program;
+}
 
-        // Текстурные координаты
-        vertexData[index++] = model->texCoords[face.uvIndex][0];
-        vertexData[index++] = model->texCoords[face.uvIndex][1];
+unsigned int loadProgram(const char* vertexName, const char* fragmentName) {
+    ProgramBuild b;
+    beginProgram(&b, vertexName, fragmentName);
+    return endProgram(&b);
+}
 
-        // Нормали
-        vertexData[index++] = model->normals[face.normalIndex][0];
-        vertexData[index++] = model->normals[face.normalIndex][1];
-        vertexData[index++] = model->normals[face.normalIndex][2];
+// Слежение за каталогом ресурсов и шейдеров. Из архива ресурсы не перезагружаются: он только читается
+void startHotReload() {
+    watcher.fd = -1;
+    if (!HOT_RELOAD)
+        return;
+    if (assetArchive.map) {
+        printf("Hot reload disabled: assets come from the archive\n");
+        return;
     }
+    char shaderDir[600];
+    snprintf(shaderDir, sizeof(shaderDir), "%sshaders/", resDir);
+    if (watchInit(&watcher) == 0 && watchAdd(&watcher, resDir, "") == 0)
+        watchAdd(&watcher, shaderDir, "shaders/");
+}
 
-    // Загрузка данных вершин в VBO
-    glBindBuffer(GL_ARRAY_BUFFER, *VBO);
-    glBufferData(GL_ARRAY_BUFFER, model->numFaces * 3 * 8 * sizeof(float), vertexData, GL_DYNAMIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0); 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float))); 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+void hotTexture(TextureAsset* t, unsigned int* handle) {
+    HotAsset* h = &hotAssets[numHotAssets++];
+    memset(h, 0, sizeof(*h));
+    h->texture = t;
+    h->handle = handle;
+}
 
-    free(vertexData);
-    glBindVertexArray(0);
+void hotModel(ModelAsset* a, Mesh* mesh, unsigned int* VAO, unsigned int* VBO, unsigned int* EBO) {
+    HotAsset* h = &hotAssets[numHotAssets++];
+    memset(h, 0, sizeof(*h));
+    h->model = a;
+    h->mesh = mesh;
+    h->VAO = VAO;
+    h->VBO = VBO;
+    h->EBO = EBO;
+}
+
+void hotProgram(const char* vertex, const char* fragment, unsigned int* program) {
+    hotPrograms[numHotPrograms++] = (HotProgram){vertex, fragment, program, 0};
+}
+
+const char* hotAssetName(const HotAsset* h) {
+    return h->texture ? h->texture->name : h->model->name;
+}
+
+// Рабочий поток: тот же загрузчик, что и при запуске, но в запасную копию асета
+void reloadHotAsset(void* arg) {
+    HotAsset* h = arg;
+    if (h->texture) {
+        h->nextTexture = (TextureAsset){.name = h->texture->name};
+        decodeTexture(&h->nextTexture);
+    } else {
+        const ModelAsset* m = h->model;
+        h->nextModel = (ModelAsset){.name = m->name, .scale = m->scale, .zoffset = m->zoffset, .ydir = m->ydir,
+                                    .yoffset = m->yoffset, .change = m->change, .keepCpuData = m->keepCpuData};
+        prepareModel(&h->nextModel);
+    }
+}
+
+// Поток GL: новые объекты рядом со старыми; при ошибке загрузки старые остаются
+void finishHotAsset(HotAsset* h) {
+    if (h->texture) {
+        TextureAsset* t = &h->nextTexture;
+        if (!t->cache.header && !t->pixels) {
+            printf("Reload failed, keeping previous version: %s\n", t->name);
+            h->state = HOT_IDLE;
+            return;
+        }
+        textureMemoryUsed -= h->texture->bytes; // Старая текстура скоро удаляется, бюджет считается без нее
+        h->nextHandle = finishTexture(t);
+    } else {
+        ModelAsset* a = &h->nextModel;
+        if (!a->cache.header && !a->mesh.numIndices) {
+            printf("Reload failed, keeping previous version: %s\n", a->name);
+            releaseModelAsset(a);
+            h->state = HOT_IDLE;
+            return;
+        }
+        finishModel(a, &h->nextMesh, &h->nextVAO, &h->nextVBO, &h->nextEBO, 0); // Подмена - после очереди загрузки
+    }
+    h->state = HOT_UPLOADING;
+}
+
+// Между кадрами, когда очередь загрузки пуста: старые объекты удаляются, кадр рисует новые
+void swapHotAsset(HotAsset* h) {
+    if (h->texture) {
+        glDeleteTextures(1, h->handle);
+        *h->handle = h->nextHandle;
+        h->texture->bytes = h->nextTexture.bytes;
+    } else {
+        glDeleteVertexArrays(1, h->VAO);
+        glDeleteBuffers(1, h->VBO);
+        glDeleteBuffers(1, h->EBO);
+        freeMeshData(h->mesh);
+        *h->mesh = h->nextMesh;
+        *h->VAO = h->nextVAO;
+        *h->VBO = h->nextVBO;
+        *h->EBO = h->nextEBO;
+    }
+    h->state = HOT_IDLE;
+    printf("Reloaded %s in %.0f ms\n", hotAssetName(h), (glfwGetTime() - h->start) * 1e3);
+}
+
+// Раз в кадр: события файлов, готовые задачи перезагрузки, подмена объектов. Шейдеры собираются сразу
+void updateHotReload() {
+    char name[320];
+    double now = glfwGetTime();
+    while (watchNext(&watcher, name, sizeof(name))) {
+        for (int i = 0; i < numHotPrograms; i++)
+            if (strcmp(name, hotPrograms[i].vertex) == 0 || strcmp(name, hotPrograms[i].fragment) == 0)
+                hotPrograms[i].dirty = 1;
+        for (int i = 0; i < numHotAssets; i++)
+            if (strcmp(name, hotAssetName(&hotAssets[i])) == 0)
+                hotAssets[i].dirty = 1;
+        lastFileChange = now;
+    }
+
+    for (int group; reloadGroups && (group = assetPollGroup(&reloadJobs)) >= 0;) {
+        finishHotAsset(&hotAssets[reloadAsset[group]]);
+        if (--reloadGroups == 0)
+            assetShutdown(&reloadJobs);
+    }
+    int busy = reloadGroups > 0;
+    for (int i = 0; i < numHotAssets; i++) {
+        if (hotAssets[i].state == HOT_UPLOADING && !uploader.count)
+            swapHotAsset(&hotAssets[i]);
+        busy |= hotAssets[i].state != HOT_IDLE;
+    }
+    if (now - lastFileChange < HOT_RELOAD_SETTLE)
+        return;
+
+    for (int i = 0; i < numHotPrograms; i++) {
+        HotProgram* p = &hotPrograms[i];
+        if (!p->dirty)
+            continue;
+        p->dirty = 0;
+        double start = glfwGetTime();
+        unsigned int prog = loadProgram(p->vertex, p->fragment);
+        if (!prog) {
+            printf("Reload failed, keeping previous program: %s + %s\n", p->vertex, p->fragment);
+            continue;
+        }
+        glDeleteProgram(*p->program);
+        *p->program = prog;
+        printf("Reloaded %s + %s in %.1f ms\n", p->vertex, p->fragment, (glfwGetTime() - start) * 1e3);
+    }
+
+    // Новая партия - после того как предыдущая целиком подменена (запасные копии асетов свободны)
+    if (busy)
+        return;
+    for (int i = 0; i < numHotAssets; i++) {
+        HotAsset* h = &hotAssets[i];
+        if (!h->dirty)
+            continue;
+        if (!reloadGroups)
+            assetInit(&reloadJobs, 0);
+        int job = assetAddJob(&reloadJobs, reloadHotAsset, h);
+        reloadAsset[assetAddGroup(&reloadJobs, &job, 1)] = i;
+        reloadGroups++;
+        h->dirty = 0;
+        h->state = HOT_LOADING;
+        h->start = now;
+    }
+    if (reloadGroups)
+        assetStart(&reloadJobs);
 }
-int main()
+
+int main(int argc, char** argv)
 {
+    Replay replay;
+    int playback = argc > 1, recording = !playback;
+    if (playback && replayLoad(argv[1], &replay) != 0)
+        return 1;
+
     glfwInit(); // Создание контекста opengl
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -676,10 +979,33 @@ int main()
         return -1;
     }
     glfwMakeContextCurrent(window);
-    glfwSwapInterval(1);
+    glfwSwapInterval(RENDER_VSYNC);
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
         return -1;
     glViewport(0, 0, mode->width, mode->height);
+    textureS3tc = TEXTURE_COMPRESS && hasGlExtension("GL_EXT_texture_compression_s3tc");
+    programCacheInit((GLADloadproc)glfwGetProcAddress, !EMBED_ASSETS && hasGlExtension("GL_ARB_get_program_binary"), // Встроенная сборка не пишет на диск
+                     hasGlExtension("GL_KHR_parallel_shader_compile") || hasGlExtension("GL_ARB_parallel_shader_compile"));
+    uploaderInit(&uploader);
+    openAssets();
+    startHotReload();
+
+    // Разбор моделей и декодирование текстур на пуле потоков, пока здесь компилируются шейдеры.
+    // Группа отдается в GL целиком: модель вместе со своей текстурой
+    double loadStart = glfwGetTime();
+    TextureAsset backAsset = {.name = "back.png"}, enemyTexAsset = {.name = "fighter_texture.jpg"},
+                 shipTexAsset = {.name = "Ship_texture.png"};
+    ModelAsset enemyAsset = {.name = "fighter.obj", .scale = .05f, .zoffset = 0.2f, .ydir = 1.0f, .yoffset = -0.3f, .change = 0};
+    ModelAsset playerAsset = {.name = "SpaseShip.obj", .scale = .05f, .zoffset = -0.2f, .ydir = 1.0f, .yoffset = -0.3f, .change = 1};
+    AssetScheduler assets;
+    assetInit(&assets, 0);
+    int backJob = assetAddJob(&assets, decodeTexture, &backAsset);
+    int enemyJobs[2] = {assetAddJob(&assets, prepareModel, &enemyAsset), assetAddJob(&assets, decodeTexture, &enemyTexAsset)};
+    int playerJobs[2] = {assetAddJob(&assets, prepareModel, &playerAsset), assetAddJob(&assets, decodeTexture, &shipTexAsset)};
+    int backGroup = assetAddGroup(&assets, &backJob, 1);
+    int enemyGroup = assetAddGroup(&assets, enemyJobs, 2);
+    int playerGroup = assetAddGroup(&assets, playerJobs, 2);
+    assetStart(&assets);
 
     mat4 model, view, projection; // Блок обработки камеры
     glm_mat4_identity(model);
@@ -691,48 +1017,15 @@ int main()
     vec3 up = {0.0f, 1.0f, 1.0f};     
     glm_lookat(eye, center, up, view);
 
-    unsigned int vs = glCreateShader(GL_VERTEX_SHADER); // Блок комплиляции шейдеров
-    glShaderSource(vs, 1, &vertexShaderSource, NULL);
-    glCompileShader(vs);
-    unsigned int fs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fs, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fs);
-    unsigned int prog = glCreateProgram();
-    glAttachShader(prog, vs);
-    glAttachShader(prog, fs);
-    glLinkProgram(prog);
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-
-    unsigned int pvs = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(pvs, 1, &primvetexshader, NULL);
-    glCompileShader(pvs);
-    checkShaderCompileErrors(pvs);
-    unsigned int pfs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(pfs, 1, &primefragmentshader, NULL);
-    glCompileShader(pfs);
-    checkShaderCompileErrors(pfs);
-    unsigned int primprog = glCreateProgram();
-    glAttachShader(primprog, pvs);
-    glAttachShader(primprog, pfs);
-    glLinkProgram(primprog);
-    glDeleteShader(pvs);
-    glDeleteShader(pfs);
-
-    unsigned int mvs = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(mvs, 1, &modelvertexShaderSource, NULL);
-    glCompileShader(mvs);
-    checkShaderCompileErrors(mvs);
-    unsigned int mfs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(mfs, 1, &modelfragmentShaderSource, NULL);
-    glCompileShader(mfs);
-    checkShaderCompileErrors(mfs);
-    unsigned int mprog = glCreateProgram();
-    glAttachShader(mprog, mvs);
-    glAttachShader(mprog, mfs);
-    glLinkProgram(mprog);
-    glDeleteShader(mvs);
-    glDeleteShader(mfs);
+    // Блок комплиляции шейдеров: программы из кеша бинарников или компиляция, которая при параллельной
+    // компиляции идет на потоках драйвера, пока ниже в GL загружаются готовые ресурсы
+    double shaderStart = glfwGetTime();
+    int parallelShaders = parallelShaderCompile();
+    ProgramBuild builds[3];
+    beginProgram(&builds[0], "shaders/color.vert", "shaders/color.frag");
+    beginProgram(&builds[1], "shaders/background.vert", "shaders/background.frag");
+    beginProgram(&builds[2], "shaders/model.vert", "shaders/model.frag");
+    double shaderTime = glfwGetTime() - shaderStart;
 
     float backgroundVertices[] = { // Буфер фона и его обработка
         1.0f, 1.0f, 0.0f, 1.0f, 1.0f,  
@@ -746,8 +1039,6 @@ int main()
         1, 2, 3  
     };
 
-    unsigned int texture = loadTexture("../res/back.png"); 
-
     unsigned int VBO_bg, VAO_bg, EBO;
     glGenVertexArrays(1, &VAO_bg);
     glGenBuffers(1, &VBO_bg);
@@ -786,57 +1077,101 @@ int main()
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
-    Model enemymodel; // Загрузка модели врага
-    memset(&enemymodel, 0, sizeof(Model));
-    loadObj("../res/fighter.obj", &enemymodel,.05f, 0.2f, 1.0f, -0.3f, 0);
-    unsigned int VBO_e, VAO_e;
-    setupModelBuffers(&enemymodel,&VAO_e,&VBO_e);
-    unsigned int enemytexture = loadTexture("../res/fighter_texture.jpg");
-
-
-    Model playermodel; //Загрузка модели игрока
-    memset(&playermodel, 0, sizeof(Model));
-    loadObj("../res/SpaseShip.obj", &playermodel,.05f, -0.2f, 1.0f, -0.3f, 1);
-    unsigned int VBO, VAO;
-    setupModelBuffers(&playermodel,&VAO,&VBO);
-
-    unsigned int shiptexture = loadTexture("../res/Ship_texture.png");
-
-    srand((unsigned)time(NULL));
-    spawnFormation();
-    lastDiveTime = glfwGetTime();
+    Mesh enemymodel, playermodel; // Загрузка в GL по мере готовности групп
+    unsigned int VBO_e, VAO_e, EBO_e, VBO, VAO, EBO_p;
+    unsigned int texture = 0, enemytexture = 0, shiptexture = 0;
+    for (int group; (group = assetNextGroup(&assets)) >= 0;) {
+        if (group == backGroup) {
+            texture = finishTexture(&backAsset);
+        } else if (group == enemyGroup) {
+            finishModel(&enemyAsset, &enemymodel, &VAO_e, &VBO_e, &EBO_e, 1); // Меши небольшие и рисуются с первого кадра
+            enemytexture = finishTexture(&enemyTexAsset);
+        } else if (group == playerGroup) {
+            finishModel(&playerAsset, &playermodel, &VAO, &VBO, &EBO_p, 1);
+            shiptexture = finishTexture(&shipTexAsset);
+        }
+    }
+    assetShutdown(&assets);
+    printf("Assets decoded in %.0f ms\n", (glfwGetTime() - loadStart) * 1e3);
+
+    shaderStart = glfwGetTime();
+    unsigned int prog = endProgram(&builds[0]);
+    unsigned int primprog = endProgram(&builds[1]);
+    unsigned int mprog = endProgram(&builds[2]);
+    shaderTime += glfwGetTime() - shaderStart;
+    printf("Shaders: %d of 3 programs from binary cache, %.1f ms on the GL thread%s\n",
+           builds[0].cached + builds[1].cached + builds[2].cached, shaderTime * 1e3,
+           parallelShaders ? " (parallel compile)" : "");
+    hotProgram("shaders/color.vert", "shaders/color.frag", &prog);
+    hotProgram("shaders/background.vert", "shaders/background.frag", &primprog);
+    hotProgram("shaders/model.vert", "shaders/model.frag", &mprog);
+    hotTexture(&backAsset, &texture);
+    hotTexture(&enemyTexAsset, &enemytexture);
+    hotTexture(&shipTexAsset, &shiptexture);
+    hotModel(&enemyAsset, &enemymodel, &VAO_e, &VBO_e, &EBO_e);
+    hotModel(&playerAsset, &playermodel, &VAO, &VBO, &EBO_p);
+
+    uint64_t seed = playback ? replay.seed : (uint64_t)time(NULL);
+    printf("Game seed: %llu\n", (unsigned long long)seed);
+    if (playback)
+        printf("Replay %s: %u ticks, %.1f s\n", argv[1], replay.ticks, replay.ticks * (double)SIM_DT);
+    else
+        replayRecordStart(&replay, seed);
+    simInit(seed);
 
-    float x = 0.0f;
+    int startupUploads = 1;
+    SimClock clock = {0};
+    double frameStart = glfwGetTime();
     while (!glfwWindowShouldClose(window))
     {
-        processInput(window,&x);
+        if (uploader.count && uploaderPump(&uploader, UPLOAD_FRAME_BYTES) == 0 && startupUploads) { // Остаток загрузок идет параллельно с кадрами
+            printf("GPU uploads finished in %.0f ms: %.2f MB, staging busy %u times, map failed %u times\n",
+                   (glfwGetTime() - loadStart) * 1e3, uploader.totalBytes / (1024.0 * 1024.0), uploader.busySkips,
+                   uploader.mapFailures);
+            startupUploads = 0;
+        }
+        updateHotReload();
+
+        // Симуляция фиксированными шагами: сколько тиков накопилось за кадр, столько и выполняется
+        double now = glfwGetTime();
+        int ticks = simClockAdvance(&clock, now - frameStart);
+        frameStart = now;
+        SimInput input = processInput(window);
+        for (int i = 0; i < ticks && !gameOver; i++) {
+            if (recording && replayRecord(&replay, &input) != 0) {
+                printf("Failed to record replay: out of memory, recording stopped\n");
+                recording = 0;
+            }
+            if (playback && !replayNext(&replay, &input)) {
+                glfwSetWindowShouldClose(window, 1);
+                break;
+            }
+            simTick(&input);
+            for (int j = 0; j < MAX_ENEMIES; j++) // Флаги тика живут до следующего, кадр может вместить несколько
+                enemyFlash[j] |= enemies.hit[j];
+            playerFlash |= playerIsHit;
+        }
+        if (gameOver) {
+            printf("Skill issue get good");
+            glfwSetWindowShouldClose(window, 1);
+        }
+        float alpha = simClockAlpha(&clock); // Доля следующего тика: отрисовка между прошлым и текущим
+        float drawX = playerPrevX + (playerX - playerPrevX) * alpha;
+
         glClear(GL_COLOR_BUFFER_BIT); // Фон
         glUseProgram(primprog);
         glBindTexture(GL_TEXTURE_2D, texture);
         glBindVertexArray(VAO_bg);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
-        updateEnemy(); // Юлок обработки врагов и пуль
-        updateBullets();
-        for (int j = 0; j < MAX_ENEMIES; j++)
-            if (enemies[j].active && rand() % 500 == 0)
-                shootEnemyBullet(enemies[j].x, enemies[j].y, 2);
-        updateEnemyMovement(x);
-        diveAttack(x);
-        for (int i = 0; i < MAX_ENEMIES; i++)
-            if (enemies[i].active && enemies[i].diving)
-                shootEnemyBullet(enemies[i].x, enemies[i].y, 0.5);
-        checkDiveCollisions(x);
-        updatePlayerHits(x);
-
-        drawBullets(prog, VAO_b, model, view, projection);
+        drawBullets(prog, VAO_b, model, view, projection, alpha);
 
         glUseProgram(mprog); //Блок обработки игрока
         int off = glGetUniformLocation(mprog, "offset");
         int hitLoc = glGetUniformLocation(mprog, "isHit");
 
-        glUniform3f(off, x, 0.0f, 0.0f);
-        glUniform1i(hitLoc, playerIsHit);
+        glUniform3f(off, drawX, 0.0f, 0.0f);
+        glUniform1i(hitLoc, playerFlash);
 
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, shiptexture);
@@ -846,12 +1181,13 @@ int main()
         glUniformMatrix4fv(glGetUniformLocation(mprog, "view"), 1, GL_FALSE, &view[0][0]);
         glUniformMatrix4fv(glGetUniformLocation(mprog, "projection"), 1, GL_FALSE, &projection[0][0]);
 
+        setMeshDecode(mprog, &playermodel);
         glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, playermodel.numFaces);
+        drawMesh(&playermodel);
 
-        drawEnemy(mprog, VAO_e, &enemymodel, enemytexture,model, view, projection);
+        drawEnemy(mprog, VAO_e, &enemymodel, enemytexture,model, view, projection, (float)mode->height, alpha);
 
-        playerIsHit = 0;
+        playerFlash = 0;
 
         glfwSwapBuffers(window);
         glfwPollEvents();
@@ -859,17 +1195,29 @@ int main()
 
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO_p);
     glDeleteProgram(prog);
     glDeleteVertexArrays(1, &VAO_e);
     glDeleteBuffers(1, &VBO_e);
+    glDeleteBuffers(1, &EBO_e);
     glDeleteProgram(mprog);
     glDeleteVertexArrays(1, &VAO_bg);
     glDeleteBuffers(1, &VBO_bg);
     glDeleteProgram(primprog);
     glDeleteVertexArrays(1, &VAO_b);
     glDeleteBuffers(1, &VBO_b);
-    freeModel(&playermodel);
-    freeModel(&enemymodel);
+    if (reloadGroups)
+        assetShutdown(&reloadJobs);
+    watchClose(&watcher);
+    uploaderDestroy(&uploader);
+    closeArchive(&assetArchive);
+    freeMeshData(&playermodel);
+    freeMeshData(&enemymodel);
+    char replayPath[600];
+    snprintf(replayPath, sizeof(replayPath), "%s%s", exeDir, REPLAY_RECORD);
+    if (recording && replaySave(&replay, replayPath) == 0) // Ошибку печатает replaySave
+        printf("Replay saved to %s: %u ticks\n", replayPath, replay.ticks);
+    replayFree(&replay);
     glfwTerminate();
     return 0;
 }
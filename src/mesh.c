@@ -0,0 +1,424 @@
+#include "mesh.h"
+#include "cook.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MESH_EMPTY_SLOT 0xFFFFFFFFu
+
+_Static_assert(sizeof(MeshCacheHeader) == 112, "MeshCacheHeader layout is part of the .g3dm format");
+_Static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+static uint32_t hashCorner(const Face* f)
+{
+    uint32_t h = f->vertexIndex * 73856093u ^ f->uvIndex * 19349663u ^ f->normalIndex * 83492791u;
+    h ^= h >> 16; // Перемешивание младших бит для маски таблицы
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+static void writeVertex(const Model* model, const Face* face, float* out)
+{
+    // Позиция
+    out[0] = model->vertices[face->vertexIndex][0];
+    out[1] = model->vertices[face->vertexIndex][1];
+    out[2] = model->vertices[face->vertexIndex][2];
+
+    // Текстурные координаты (нули, если в грани их нет)
+    int hasUv = face->uvIndex != OBJ_NO_INDEX;
+    out[3] = hasUv ? model->texCoords[face->uvIndex][0] : 0.0f;
+    out[4] = hasUv ? model->texCoords[face->uvIndex][1] : 0.0f;
+
+    // Нормали
+    int hasNormal = face->normalIndex != OBJ_NO_INDEX;
+    out[5] = hasNormal ? model->normals[face->normalIndex][0] : 0.0f;
+    out[6] = hasNormal ? model->normals[face->normalIndex][1] : 0.0f;
+    out[7] = hasNormal ? model->normals[face->normalIndex][2] : 0.0f;
+}
+
+int buildMesh(const Model* model, Mesh* mesh)
+{
+    memset(mesh, 0, sizeof(*mesh));
+    unsigned int corners = model->numFaces;
+    size_t capacity = 16;
+    while (capacity < (size_t)corners * 2)
+        capacity <<= 1;
+
+    uint32_t* table = malloc(capacity * sizeof(uint32_t));
+    Face* keys = malloc((corners ? corners : 1) * sizeof(Face));
+    mesh->indices = malloc((corners ? corners : 1) * sizeof(unsigned int));
+    mesh->vertices = malloc((corners ? corners : 1) * MESH_VERTEX_FLOATS * sizeof(float));
+    if (!table || !keys || !mesh->indices || !mesh->vertices) {
+        printf("Out of memory while indexing mesh\n");
+        free(table);
+        free(keys);
+        freeMeshData(mesh);
+        return -1;
+    }
+    memset(table, 0xFF, capacity * sizeof(uint32_t));
+
+    unsigned int unique = 0;
+    for (unsigned int i = 0; i < corners; i++) {
+        const Face* f = &model->faces[i];
+        size_t slot = hashCorner(f) & (capacity - 1);
+        while (table[slot] != MESH_EMPTY_SLOT) { // Линейное пробирование
+            const Face* k = &keys[table[slot]];
+            if (k->vertexIndex == f->vertexIndex && k->uvIndex == f->uvIndex && k->normalIndex == f->normalIndex)
+                break;
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (table[slot] == MESH_EMPTY_SLOT) {
+            table[slot] = unique;
+            keys[unique] = *f;
+            writeVertex(model, f, mesh->vertices + (size_t)unique * MESH_VERTEX_FLOATS);
+            unique++;
+        }
+        mesh->indices[i] = table[slot];
+    }
+    free(table);
+    free(keys);
+
+    float* shrunk = realloc(mesh->vertices, (unique ? unique : 1) * MESH_VERTEX_FLOATS * sizeof(float));
+    if (shrunk)
+        mesh->vertices = shrunk;
+    mesh->numVertices = unique;
+    mesh->numIndices = corners;
+    mesh->indexSize = unique <= 65536 ? 2 : 4;
+
+    for (int k = 0; k < 3; k++) {
+        mesh->boundsMin[k] = unique ? INFINITY : 0.0f;
+        mesh->boundsMax[k] = unique ? -INFINITY : 0.0f;
+    }
+    for (unsigned int i = 0; i < unique; i++) {
+        const float* p = mesh->vertices + (size_t)i * MESH_VERTEX_FLOATS;
+        for (int k = 0; k < 3; k++) {
+            if (p[k] < mesh->boundsMin[k])
+                mesh->boundsMin[k] = p[k];
+            if (p[k] > mesh->boundsMax[k])
+                mesh->boundsMax[k] = p[k];
+        }
+    }
+    return 0;
+}
+
+unsigned int meshVertexStride(unsigned int vertexFormat)
+{
+    return vertexFormat == MESH_FORMAT_PACKED ? sizeof(PackedVertex) : MESH_VERTEX_FLOATS * sizeof(float);
+}
+
+// float -> half с округлением к ближайшему четному
+static uint16_t floatToHalf(float f)
+{
+    uint32_t x;
+    memcpy(&x, &f, 4);
+    uint32_t sign = (x >> 16) & 0x8000u;
+    uint32_t absx = x & 0x7FFFFFFFu;
+    if (absx >= 0x7F800000u) // inf / nan
+        return (uint16_t)(sign | 0x7C00u | (absx > 0x7F800000u ? 0x200u : 0));
+    if (absx >= 0x477FF000u) // Переполнение half
+        return (uint16_t)(sign | 0x7C00u);
+    if (absx < 0x38800000u) { // Денормализованные half
+        float af;
+        memcpy(&af, &absx, 4);
+        return (uint16_t)(sign | (uint32_t)lrintf(af * 16777216.0f)); // af / 2^-24
+    }
+    uint32_t h = ((absx - 0x38000000u) >> 13);
+    uint32_t rest = absx & 0x1FFFu;
+    if (rest > 0x1000u || (rest == 0x1000u && (h & 1)))
+        h++;
+    return (uint16_t)(sign | h);
+}
+
+static float halfToFloat(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    uint32_t e = (h >> 10) & 0x1F, m = h & 0x3FF;
+    float f;
+    if (e == 0) {
+        f = m * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+    uint32_t x = sign | (e == 31 ? 0x7F800000u | (m << 13) : ((e + 112) << 23) | (m << 13));
+    memcpy(&f, &x, 4);
+    return f;
+}
+
+static uint32_t packSnorm10(float v)
+{
+    if (v > 1.0f)
+        v = 1.0f;
+    if (v < -1.0f)
+        v = -1.0f;
+    return (uint32_t)(lrintf(v * 511.0f) & 0x3FF);
+}
+
+static float unpackSnorm10(uint32_t bits)
+{
+    int v = (int)(bits & 0x3FF);
+    if (v & 0x200)
+        v -= 0x400;
+    float f = v / 511.0f;
+    return f < -1.0f ? -1.0f : f;
+}
+
+PackedVertex* packMeshVertices(const Mesh* mesh)
+{
+    PackedVertex* packed = malloc((mesh->numVertices ? mesh->numVertices : 1) * sizeof(PackedVertex));
+    if (!packed)
+        return NULL;
+    float inv[3];
+    for (int k = 0; k < 3; k++) {
+        float extent = mesh->boundsMax[k] - mesh->boundsMin[k];
+        inv[k] = extent > 0.0f ? 65535.0f / extent : 0.0f;
+    }
+    for (unsigned int i = 0; i < mesh->numVertices; i++) {
+        const float* v = mesh->vertices + (size_t)i * MESH_VERTEX_FLOATS;
+        PackedVertex* p = &packed[i];
+        for (int k = 0; k < 3; k++) {
+            long q = lrintf((v[k] - mesh->boundsMin[k]) * inv[k]);
+            p->pos[k] = (uint16_t)(q < 0 ? 0 : (q > 65535 ? 65535 : q));
+        }
+        p->pos[3] = 0;
+        p->uv[0] = floatToHalf(v[3]);
+        p->uv[1] = floatToHalf(v[4]);
+
+        // Нормаль нормируется перед упаковкой, w = 0
+        float len = sqrtf(v[5] * v[5] + v[6] * v[6] + v[7] * v[7]);
+        float s = len > 0.0f ? 1.0f / len : 0.0f;
+        p->normal = packSnorm10(v[5] * s) | (packSnorm10(v[6] * s) << 10) | (packSnorm10(v[7] * s) << 20);
+    }
+    return packed;
+}
+
+MeshPackError measurePackError(const Mesh* mesh, const PackedVertex* packed)
+{
+    MeshPackError err = {0.0f, 0.0f, 0.0f};
+    float minCos = 1.0f;
+    for (unsigned int i = 0; i < mesh->numVertices; i++) {
+        const float* v = mesh->vertices + (size_t)i * MESH_VERTEX_FLOATS;
+        const PackedVertex* p = &packed[i];
+        for (int k = 0; k < 3; k++) {
+            float extent = mesh->boundsMax[k] - mesh->boundsMin[k];
+            float decoded = mesh->boundsMin[k] + p->pos[k] / 65535.0f * extent;
+            float e = extent > 0.0f ? fabsf(decoded - v[k]) / extent : fabsf(decoded - v[k]);
+            if (e > err.pos)
+                err.pos = e;
+        }
+        for (int k = 0; k < 2; k++) {
+            float e = fabsf(halfToFloat(p->uv[k]) - v[3 + k]);
+            if (e > err.uv)
+                err.uv = e;
+        }
+        float n[3] = {unpackSnorm10(p->normal), unpackSnorm10(p->normal >> 10), unpackSnorm10(p->normal >> 20)};
+        float la = sqrtf(v[5] * v[5] + v[6] * v[6] + v[7] * v[7]);
+        float lb = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (la > 0.0f && lb > 0.0f) {
+            float c = (v[5] * n[0] + v[6] * n[1] + v[7] * n[2]) / (la * lb);
+            if (c < minCos)
+                minCos = c;
+        }
+    }
+    err.normalDeg = acosf(minCos > 1.0f ? 1.0f : minCos) * 57.2957795f;
+    return err;
+}
+
+int packErrorAcceptable(const MeshPackError* err)
+{
+    return err->pos <= MESH_PACK_MAX_POS_ERROR && err->uv <= MESH_PACK_MAX_UV_ERROR &&
+           err->normalDeg <= MESH_PACK_MAX_NORMAL_DEG;
+}
+
+void* packMeshIndices(const Mesh* mesh)
+{
+    if (mesh->indexSize != 2)
+        return mesh->indices;
+    uint16_t* packed = malloc((mesh->numIndices ? mesh->numIndices : 1) * sizeof(uint16_t));
+    if (!packed)
+        return NULL;
+    for (unsigned int i = 0; i < mesh->numIndices; i++)
+        packed[i] = (uint16_t)mesh->indices[i];
+    return packed;
+}
+
+void freeMeshData(Mesh* mesh)
+{
+    free(mesh->vertices);
+    free(mesh->indices);
+    mesh->vertices = NULL;
+    mesh->indices = NULL;
+}
+
+static void fillMeshCacheHeader(MeshCacheHeader* h, uint64_t srcHash, uint64_t srcSize, float scale, float zoffset, float ydir, float yoffset, int change)
+{
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, MESHCACHE_MAGIC, 4);
+    h->version = MESHCACHE_VERSION;
+    h->srcHash = srcHash;
+    h->srcSize = srcSize;
+    h->scale = scale;
+    h->zoffset = zoffset;
+    h->ydir = ydir;
+    h->yoffset = yoffset;
+    h->change = change;
+}
+
+uint64_t meshCookKey(uint64_t srcHash, float scale, float zoffset, float ydir, float yoffset, int change, unsigned int vertexFormat,
+                     int optimizeOverdraw, const float* lodRatios, float lodMaxError)
+{
+    struct {
+        uint32_t version;
+        float scale, zoffset, ydir, yoffset;
+        int32_t change;
+        uint32_t vertexFormat;
+        int32_t optimizeOverdraw;
+        float lodRatios[MESH_MAX_LODS], lodMaxError;
+        float packPosError, packUvError, packNormalDeg; // Меняют выбор формата вершин
+    } params = {MESHCACHE_VERSION, scale, zoffset, ydir, yoffset, change, vertexFormat, optimizeOverdraw, {0}, lodMaxError,
+                MESH_PACK_MAX_POS_ERROR, MESH_PACK_MAX_UV_ERROR, MESH_PACK_MAX_NORMAL_DEG};
+    memcpy(params.lodRatios, lodRatios, sizeof(params.lodRatios));
+    return cookKey(srcHash, &params, sizeof(params));
+}
+
+// 1 - все индексы меньше numVertices (иначе glDrawElements прочтет за концом вершинного буфера)
+static int indicesInRange(const void* indices, unsigned int numIndices, unsigned int indexSize, unsigned int numVertices)
+{
+    unsigned int maxIndex = 0;
+    if (indexSize == 2) {
+        const uint16_t* p = indices;
+        for (unsigned int i = 0; i < numIndices; i++)
+            maxIndex = p[i] > maxIndex ? p[i] : maxIndex;
+    } else {
+        const uint32_t* p = indices;
+        for (unsigned int i = 0; i < numIndices; i++)
+            maxIndex = p[i] > maxIndex ? p[i] : maxIndex;
+    }
+    return numIndices == 0 || maxIndex < numVertices;
+}
+
+// Проверка кеша в памяти против ожидаемого заголовка (исходник, параметры, целостность размеров и индексов)
+static int validMeshCache(const void* data, size_t size, const MeshCacheHeader* expect, unsigned int vertexFormat, MeshCacheView* view)
+{
+    const MeshCacheHeader* h = data;
+    if (size < sizeof(MeshCacheHeader))
+        return 0;
+    int formatOk = (h->vertexFormat == MESH_FORMAT_FLOAT || h->vertexFormat == MESH_FORMAT_PACKED) &&
+                   h->vertexStride == meshVertexStride(h->vertexFormat) && h->requestedFormat == vertexFormat;
+    size_t vertexBytes = (size_t)h->numVertices * h->vertexStride;
+    size_t indexBytes = (size_t)h->numIndices * h->indexSize;
+    uint64_t lodIndices = 0;
+    for (int l = 0; l < MESH_MAX_LODS; l++)
+        lodIndices += h->lodCount[l];
+    int lodsOk = h->numLods >= 1 && h->numLods <= MESH_MAX_LODS && lodIndices == h->numIndices;
+    int ok = memcmp(h->magic, expect->magic, 4) == 0 && h->version == expect->version &&
+             formatOk && lodsOk && (h->indexSize == 2 || h->indexSize == 4) &&
+             h->srcHash == expect->srcHash && h->srcSize == expect->srcSize &&
+             h->scale == expect->scale && h->zoffset == expect->zoffset && h->ydir == expect->ydir &&
+             h->yoffset == expect->yoffset && h->change == expect->change &&
+             size == sizeof(MeshCacheHeader) + vertexBytes + indexBytes;
+    if (!ok)
+        return 0;
+    const void* indices = (const char*)(h + 1) + vertexBytes; // Смещение кратно 16: заголовок и шаг вершин
+    if (!indicesInRange(indices, h->numIndices, h->indexSize, h->numVertices))
+        return 0;
+    view->header = h;
+    view->vertices = h + 1;
+    view->indices = indices;
+    return 1;
+}
+
+// Загрузка меша из бинарного кеша через mmap, без разбора текста
+int mapMeshCache(const char* cachePath, uint64_t srcHash, uint64_t srcSize, float scale, float zoffset, float ydir, float yoffset, int change, unsigned int vertexFormat, MeshCacheView* view)
+{
+    memset(view, 0, sizeof(*view));
+    int fd = open(cachePath, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat cst;
+    if (fstat(fd, &cst) != 0 || (size_t)cst.st_size < sizeof(MeshCacheHeader)) {
+        close(fd);
+        return 0;
+    }
+    void* map = mmap(NULL, cst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return 0;
+
+    MeshCacheHeader expect;
+    fillMeshCacheHeader(&expect, srcHash, srcSize, scale, zoffset, ydir, yoffset, change);
+    if (!validMeshCache(map, cst.st_size, &expect, vertexFormat, view)) {
+        munmap(map, cst.st_size);
+        return 0;
+    }
+    madvise(map, cst.st_size, MADV_SEQUENTIAL);
+    view->map = map;
+    view->mapSize = cst.st_size;
+    return 1;
+}
+
+int viewMeshCache(const void* data, size_t size, uint64_t srcHash, uint64_t srcSize, float scale, float zoffset, float ydir, float yoffset, int change, unsigned int vertexFormat, MeshCacheView* view)
+{
+    memset(view, 0, sizeof(*view));
+    MeshCacheHeader expect;
+    fillMeshCacheHeader(&expect, srcHash, srcSize, scale, zoffset, ydir, yoffset, change);
+    return validMeshCache(data, size, &expect, vertexFormat, view);
+}
+
+void unmapMeshCache(MeshCacheView* view)
+{
+    if (view->map)
+        munmap(view->map, view->mapSize);
+    memset(view, 0, sizeof(*view));
+}
+
+void saveMeshCache(const char* cachePath, uint64_t srcHash, uint64_t srcSize, const Mesh* mesh, unsigned int requestedFormat, float scale, float zoffset, float ydir, float yoffset, int change)
+{
+    char tmpPath[520];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", cachePath);
+    if (makeParentDir(cachePath) != 0) {
+        printf("Failed to create cook directory for: %s\n", cachePath);
+        return;
+    }
+    MeshCacheHeader h;
+    fillMeshCacheHeader(&h, srcHash, srcSize, scale, zoffset, ydir, yoffset, change);
+    h.numVertices = mesh->numVertices;
+    h.numIndices = mesh->numIndices;
+    h.indexSize = mesh->indexSize;
+    h.vertexFormat = mesh->vertexFormat;
+    h.vertexStride = meshVertexStride(mesh->vertexFormat);
+    h.requestedFormat = requestedFormat;
+    h.numLods = mesh->numLods ? mesh->numLods : 1;
+    for (unsigned int l = 0; l < h.numLods; l++)
+        h.lodCount[l] = mesh->numLods ? mesh->lodCount[l] : mesh->numIndices;
+    memcpy(h.boundsMin, mesh->boundsMin, sizeof(h.boundsMin));
+    memcpy(h.boundsMax, mesh->boundsMax, sizeof(h.boundsMax));
+
+    void* indices = packMeshIndices(mesh);
+    void* vertices = mesh->vertexFormat == MESH_FORMAT_PACKED ? (void*)packMeshVertices(mesh) : mesh->vertices;
+    FILE* file = indices && vertices ? fopen(tmpPath, "wb") : NULL; // Запись во временный файл и rename, чтобы не оставить битый кеш
+    if (!file) {
+        printf("Failed to write mesh cache: %s\n", cachePath);
+        if (indices != mesh->indices)
+            free(indices);
+        if (vertices != mesh->vertices)
+            free(vertices);
+        return;
+    }
+    int ok = fwrite(&h, sizeof(h), 1, file) == 1 && fwrite(vertices, h.vertexStride, h.numVertices, file) == h.numVertices &&
+             fwrite(indices, h.indexSize, h.numIndices, file) == h.numIndices;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(tmpPath, cachePath) != 0) {
+        printf("Failed to write mesh cache: %s\n", cachePath);
+        remove(tmpPath);
+    }
+    if (indices != mesh->indices)
+        free(indices);
+    if (vertices != mesh->vertices)
+        free(vertices);
+}
@@ -0,0 +1,105 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "objload.h"
+
+#define MESH_VERTEX_FLOATS 8 // 3 (позиция) + 2 (текстура) + 3 (нормаль)
+
+#define MESH_FORMAT_FLOAT 0  // 8 float: 32 байта на вершину
+#define MESH_FORMAT_PACKED 1 // PackedVertex: 16 байт на вершину
+
+// Допустимые ошибки сжатого формата относительно float, иначе меш остается во float
+#define MESH_PACK_MAX_POS_ERROR 1e-4f   // Доля размера AABB
+#define MESH_PACK_MAX_UV_ERROR 4.9e-4f  // ~1 тексель текстуры 2048
+#define MESH_PACK_MAX_NORMAL_DEG 1.0f
+
+typedef struct {
+    uint16_t pos[4]; // unorm16 внутри AABB меша, pos[3] - выравнивание
+    uint16_t uv[2];  // half float
+    uint32_t normal; // snorm 2_10_10_10_REV
+} PackedVertex;
+
+typedef struct {
+    float pos; // Максимальная ошибка позиции, доля размера AABB
+    float uv;
+    float normalDeg;
+} MeshPackError;
+
+#define MESH_MAX_LODS 4 // LOD0 - исходный меш, дальше упрощенные уровни
+
+#define MESHCACHE_MAGIC "G3DM"
+#define MESHCACHE_VERSION 6
+#define MESHCACHE_EXT ".g3dm"
+
+typedef struct { // Индексированный меш: уникальные вершины и тройки индексов треугольников
+    float* vertices; // numVertices * MESH_VERTEX_FLOATS
+    unsigned int* indices;
+    unsigned int numVertices;
+    unsigned int numIndices;
+    unsigned int indexSize; // Байт на индекс в GPU-буфере: 2, если хватает, иначе 4
+    unsigned int vertexFormat; // MESH_FORMAT_*, в котором вершины лежат в VBO
+
+    // Уровни детализации делят вершины; их индексы идут подряд в indices (numIndices - сумма)
+    unsigned int numLods; // 0 - уровней нет, весь indices это LOD0
+    unsigned int lodOffset[MESH_MAX_LODS];
+    unsigned int lodCount[MESH_MAX_LODS];
+
+    vec3 boundsMin;
+    vec3 boundsMax;
+} Mesh;
+
+typedef struct { // Заголовок бинарного кеша меша (.g3dm), за ним вершины и индексы размера indexSize
+    char magic[4];
+    uint32_t version;
+    uint64_t srcHash; // Хеш содержимого и размер исходного .obj (hashContent), по ним кеш и ищется
+    uint64_t srcSize;
+    float scale, zoffset, ydir, yoffset;
+    int32_t change;
+    uint32_t numVertices;
+    uint32_t vertexStride;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t numIndices;
+    uint32_t indexSize;
+    uint32_t vertexFormat;    // Фактический формат вершин в файле
+    uint32_t requestedFormat; // Запрошенный (сжатие могло быть отклонено по ошибке)
+    uint32_t numLods;
+    uint32_t lodCount[MESH_MAX_LODS]; // Индексов на уровень, уровни идут подряд
+} MeshCacheHeader;
+
+typedef struct { // Отображенный в память кеш; vertices/indices указывают прямо в отображение
+    void* map;
+    size_t mapSize;
+    const MeshCacheHeader* header;
+    const void* vertices;
+    const void* indices;
+} MeshCacheView;
+
+// Склейка одинаковых троек (vertexIndex, uvIndex, normalIndex) через хеш-таблицу. 0 при успехе
+int buildMesh(const Model* model, Mesh* mesh);
+// Индексы в формате GPU-буфера: при indexSize == 2 - новый массив uint16 (освободить), иначе mesh->indices
+void* packMeshIndices(const Mesh* mesh);
+void freeMeshData(Mesh* mesh);
+unsigned int meshVertexStride(unsigned int vertexFormat);
+
+// Сжатие вершин в PackedVertex (позиции относительно boundsMin/boundsMax). Освободить результат
+PackedVertex* packMeshVertices(const Mesh* mesh);
+// Сравнение распакованных вершин с исходными float
+MeshPackError measurePackError(const Mesh* mesh, const PackedVertex* packed);
+int packErrorAcceptable(const MeshPackError* err);
+
+// Ключ готового меша: содержимое исходника, параметры загрузки, запрошенный формат, параметры готовки (оптимизация,
+// MESH_MAX_LODS долей LOD и их ошибка, допуски сжатия) и версия кеша
+uint64_t meshCookKey(uint64_t srcHash, float scale, float zoffset, float ydir, float yoffset, int change, unsigned int vertexFormat,
+                     int optimizeOverdraw, const float* lodRatios, float lodMaxError);
+// 1 - кеш cachePath найден и собран из этого исходника с этими параметрами и запрошенным форматом вершин
+int mapMeshCache(const char* cachePath, uint64_t srcHash, uint64_t srcSize, float scale, float zoffset, float ydir, float yoffset, int change, unsigned int vertexFormat, MeshCacheView* view);
+// То же для кеша, уже лежащего в памяти (запись архива). view->map = NULL
+int viewMeshCache(const void* data, size_t size, uint64_t srcHash, uint64_t srcSize, float scale, float zoffset, float ydir, float yoffset, int change, unsigned int vertexFormat, MeshCacheView* view);
+void unmapMeshCache(MeshCacheView* view);
+// Вершины пишутся в mesh->vertexFormat; requestedFormat - формат, который просил вызывающий
+void saveMeshCache(const char* cachePath, uint64_t srcHash, uint64_t srcSize, const Mesh* mesh, unsigned int requestedFormat, float scale, float zoffset, float ydir, float yoffset, int change);
+
+#endif
@@ -0,0 +1,657 @@
+#include "meshopt.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+// Параметры функции оценки Форсайта
+#define FORSYTH_CACHE_DECAY_POWER 1.5f
+#define FORSYTH_LAST_TRI_SCORE 0.75f
+#define FORSYTH_VALENCE_BOOST_SCALE 2.0f
+#define FORSYTH_VALENCE_BOOST_POWER 0.5f
+
+MeshCacheStats analyzeVertexCache(const unsigned int* indices, unsigned int numIndices, unsigned int numVertices, unsigned int cacheSize)
+{
+    MeshCacheStats stats = {0.0f, 0.0f};
+    unsigned int* stamp = calloc(numVertices ? numVertices : 1, sizeof(unsigned int));
+    if (!stamp || numIndices < 3)
+    {
+        free(stamp);
+        return stats;
+    }
+    // FIFO через метки времени: вершина в кеше, если с момента ее загрузки было меньше cacheSize промахов
+    unsigned int time = cacheSize + 1, misses = 0, used = 0;
+    for (unsigned int i = 0; i < numIndices; i++)
+    {
+        unsigned int v = indices[i];
+        if (stamp[v] == 0)
+            used++;
+        if (time - stamp[v] > cacheSize)
+        {
+            stamp[v] = time++;
+            misses++;
+        }
+    }
+    free(stamp);
+    stats.acmr = (float)misses / (numIndices / 3);
+    stats.atvr = used ? (float)misses / used : 0.0f;
+    return stats;
+}
+
+static float forsythScore(int cachePos, unsigned int remaining)
+{
+    if (remaining == 0)
+        return -1.0f; // Вершина больше не нужна
+    float score = 0.0f;
+    if (cachePos >= 0)
+    {
+        if (cachePos < 3)
+            score = FORSYTH_LAST_TRI_SCORE; // Последний треугольник: одинаково для всех трех вершин
+        else
+            score = powf(1.0f - (float)(cachePos - 3) / (MESHOPT_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+    }
+    return score + FORSYTH_VALENCE_BOOST_SCALE * powf((float)remaining, -FORSYTH_VALENCE_BOOST_POWER);
+}
+
+int optimizeVertexCache(unsigned int* indices, unsigned int numIndices, unsigned int numVertices)
+{
+    unsigned int numTris = numIndices / 3;
+    if (numTris == 0)
+        return 0;
+    unsigned int* offsets = calloc(numVertices + 1, sizeof(unsigned int));
+    unsigned int* remaining = calloc(numVertices, sizeof(unsigned int));
+    unsigned int* adjacency = malloc(numIndices * sizeof(unsigned int));
+    int* cachePos = malloc(numVertices * sizeof(int));
+    float* vertScore = malloc(numVertices * sizeof(float));
+    float* triScore = malloc(numTris * sizeof(float));
+    char* added = calloc(numTris, 1);
+    unsigned int* out = malloc(numIndices * sizeof(unsigned int));
+    if (!offsets || !remaining || !adjacency || !cachePos || !vertScore || !triScore || !added || !out)
+    {
+        free(offsets); free(remaining); free(adjacency); free(cachePos);
+        free(vertScore); free(triScore); free(added); free(out);
+        return -1;
+    }
+
+    // Списки треугольников каждой вершины (CSR)
+    for (unsigned int i = 0; i < numIndices; i++)
+        remaining[indices[i]]++;
+    for (unsigned int v = 0; v < numVertices; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+    memset(remaining, 0, numVertices * sizeof(unsigned int));
+    for (unsigned int i = 0; i < numIndices; i++)
+    {
+        unsigned int v = indices[i];
+        adjacency[offsets[v] + remaining[v]++] = i / 3;
+    }
+
+    for (unsigned int v = 0; v < numVertices; v++)
+    {
+        cachePos[v] = -1;
+        vertScore[v] = forsythScore(-1, remaining[v]);
+    }
+    int bestTri = -1;
+    float bestScore = -1.0f;
+    for (unsigned int t = 0; t < numTris; t++)
+    {
+        triScore[t] = vertScore[indices[t * 3]] + vertScore[indices[t * 3 + 1]] + vertScore[indices[t * 3 + 2]];
+        if (triScore[t] > bestScore)
+        {
+            bestScore = triScore[t];
+            bestTri = (int)t;
+        }
+    }
+
+    unsigned int cache[MESHOPT_CACHE_SIZE + 3], newCache[MESHOPT_CACHE_SIZE + 3];
+    int cacheCount = 0;
+    unsigned int cursor = 0, emitted = 0;
+    while (emitted < numTris)
+    {
+        if (bestTri < 0)
+        { // Тупик: следующий еще не выданный треугольник по исходному порядку
+            while (added[cursor])
+                cursor++;
+            bestTri = (int)cursor;
+        }
+        unsigned int t = (unsigned int)bestTri;
+        const unsigned int* tri = &indices[t * 3];
+        memcpy(&out[emitted * 3], tri, 3 * sizeof(unsigned int));
+        emitted++;
+        added[t] = 1;
+
+        // Треугольник убирается из списков своих вершин
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = tri[k];
+            unsigned int* list = &adjacency[offsets[v]];
+            for (unsigned int j = 0; j < remaining[v]; j++)
+            {
+                if (list[j] == t)
+                {
+                    list[j] = list[remaining[v] - 1];
+                    remaining[v]--;
+                    break;
+                }
+            }
+        }
+
+        // Новый кеш: вершины треугольника впереди, остальные сдвигаются
+        int newCount = 0;
+        for (int k = 0; k < 3; k++)
+            newCache[newCount++] = tri[k];
+        for (int j = 0; j < cacheCount; j++)
+        {
+            unsigned int v = cache[j];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache[newCount++] = v;
+        }
+        for (int j = 0; j < newCount; j++)
+            cachePos[newCache[j]] = j < MESHOPT_CACHE_SIZE ? j : -1; // За пределами размера - вытесненные
+
+        // Пересчет оценок вершин, затронутых изменением кеша, и их треугольников
+        bestTri = -1;
+        bestScore = -1.0f;
+        for (int j = 0; j < newCount; j++)
+        {
+            unsigned int v = newCache[j];
+            float score = forsythScore(cachePos[v], remaining[v]);
+            float delta = score - vertScore[v];
+            vertScore[v] = score;
+            const unsigned int* list = &adjacency[offsets[v]];
+            for (unsigned int a = 0; a < remaining[v]; a++)
+            {
+                unsigned int at = list[a];
+                triScore[at] += delta;
+                if (triScore[at] > bestScore)
+                {
+                    bestScore = triScore[at];
+                    bestTri = (int)at;
+                }
+            }
+        }
+        if (newCount > MESHOPT_CACHE_SIZE)
+            newCount = MESHOPT_CACHE_SIZE;
+        memcpy(cache, newCache, newCount * sizeof(unsigned int));
+        cacheCount = newCount;
+    }
+
+    memcpy(indices, out, numTris * 3 * sizeof(unsigned int));
+    free(offsets); free(remaining); free(adjacency); free(cachePos);
+    free(vertScore); free(triScore); free(added); free(out);
+    return 0;
+}
+
+typedef struct
+{
+    unsigned int start, count; // В треугольниках
+    float potential;
+} TriCluster;
+
+static int compareClusters(const void* a, const void* b)
+{
+    const TriCluster* ca = a;
+    const TriCluster* cb = b;
+    if (ca->potential != cb->potential)
+        return ca->potential > cb->potential ? -1 : 1;
+    return ca->start < cb->start ? -1 : (ca->start > cb->start);
+}
+
+static void triangleAreaNormal(const float* vertices, const unsigned int* tri, float* n, float* centroid)
+{
+    const float* a = vertices + (size_t)tri[0] * MESH_VERTEX_FLOATS;
+    const float* b = vertices + (size_t)tri[1] * MESH_VERTEX_FLOATS;
+    const float* c = vertices + (size_t)tri[2] * MESH_VERTEX_FLOATS;
+    float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1]; // Длина = удвоенная площадь
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    for (int k = 0; k < 3; k++)
+        centroid[k] = (a[k] + b[k] + c[k]) / 3.0f;
+}
+
+int optimizeOverdraw(unsigned int* indices, unsigned int numIndices, const float* vertices, unsigned int numVertices)
+{
+    unsigned int numTris = numIndices / 3;
+    if (numTris == 0)
+        return 0;
+    TriCluster* clusters = malloc(numTris * sizeof(TriCluster));
+    unsigned int* stamp = calloc(numVertices, sizeof(unsigned int));
+    unsigned int* out = malloc(numIndices * sizeof(unsigned int));
+    if (!clusters || !stamp || !out)
+    {
+        free(clusters); free(stamp); free(out);
+        return -1;
+    }
+
+    // Границы кластеров - треугольники, все три вершины которых промахиваются мимо кеша
+    unsigned int numClusters = 0, time = MESHOPT_CACHE_SIZE + 1;
+    for (unsigned int t = 0; t < numTris; t++)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = indices[t * 3 + k];
+            if (time - stamp[v] > MESHOPT_CACHE_SIZE)
+            {
+                stamp[v] = time++;
+                misses++;
+            }
+        }
+        if (t == 0 || misses == 3)
+        {
+            clusters[numClusters].start = t;
+            clusters[numClusters].count = 0;
+            numClusters++;
+        }
+        clusters[numClusters - 1].count++;
+    }
+
+    // Центр меша, взвешенный по площади
+    double meshCenter[3] = {0, 0, 0}, meshArea = 0;
+    for (unsigned int t = 0; t < numTris; t++)
+    {
+        float n[3], c[3];
+        triangleAreaNormal(vertices, &indices[t * 3], n, c);
+        double area = sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+        for (int k = 0; k < 3; k++)
+            meshCenter[k] += c[k] * area;
+        meshArea += area;
+    }
+    for (int k = 0; k < 3; k++)
+        meshCenter[k] = meshArea > 0 ? meshCenter[k] / meshArea : 0;
+
+    // Потенциал загораживания: насколько кластер смотрит наружу от центра
+    for (unsigned int i = 0; i < numClusters; i++)
+    {
+        double center[3] = {0, 0, 0}, normal[3] = {0, 0, 0}, area = 0;
+        for (unsigned int t = clusters[i].start; t < clusters[i].start + clusters[i].count; t++)
+        {
+            float n[3], c[3];
+            triangleAreaNormal(vertices, &indices[t * 3], n, c);
+            double a = sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+            for (int k = 0; k < 3; k++)
+            {
+                center[k] += c[k] * a;
+                normal[k] += n[k];
+            }
+            area += a;
+        }
+        double len = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float potential = 0.0f;
+        if (area > 0 && len > 0)
+        {
+            for (int k = 0; k < 3; k++)
+                potential += (float)((center[k] / area - meshCenter[k]) * normal[k] / len);
+        }
+        clusters[i].potential = potential;
+    }
+    qsort(clusters, numClusters, sizeof(TriCluster), compareClusters);
+
+    unsigned int pos = 0;
+    for (unsigned int i = 0; i < numClusters; i++)
+    {
+        memcpy(&out[pos], &indices[clusters[i].start * 3], clusters[i].count * 3 * sizeof(unsigned int));
+        pos += clusters[i].count * 3;
+    }
+    memcpy(indices, out, numTris * 3 * sizeof(unsigned int));
+    free(clusters); free(stamp); free(out);
+    return 0;
+}
+
+int optimizeVertexFetch(float* vertices, unsigned int* indices, unsigned int numIndices, unsigned int numVertices)
+{
+    unsigned int* remap = malloc((numVertices ? numVertices : 1) * sizeof(unsigned int));
+    float* reordered = malloc((numVertices ? numVertices : 1) * MESH_VERTEX_FLOATS * sizeof(float));
+    if (!remap || !reordered)
+    {
+        free(remap);
+        free(reordered);
+        return -1;
+    }
+    memset(remap, 0xFF, numVertices * sizeof(unsigned int));
+    unsigned int next = 0;
+    for (unsigned int i = 0; i < numIndices; i++)
+    {
+        unsigned int v = indices[i];
+        if (remap[v] == 0xFFFFFFFFu)
+            remap[v] = next++;
+        indices[i] = remap[v];
+    }
+    for (unsigned int v = 0; v < numVertices; v++) // Неиспользуемые вершины - в конец
+        if (remap[v] == 0xFFFFFFFFu)
+            remap[v] = next++;
+    for (unsigned int v = 0; v < numVertices; v++)
+        memcpy(reordered + (size_t)remap[v] * MESH_VERTEX_FLOATS, vertices + (size_t)v * MESH_VERTEX_FLOATS,
+               MESH_VERTEX_FLOATS * sizeof(float));
+    memcpy(vertices, reordered, (size_t)numVertices * MESH_VERTEX_FLOATS * sizeof(float));
+    free(remap);
+    free(reordered);
+    return 0;
+}
+
+int optimizeMesh(Mesh* mesh, int overdraw, MeshCacheStats* before, MeshCacheStats* after)
+{
+    if (before)
+        *before = analyzeVertexCache(mesh->indices, mesh->numIndices, mesh->numVertices, MESHOPT_CACHE_SIZE);
+    if (optimizeVertexCache(mesh->indices, mesh->numIndices, mesh->numVertices) != 0)
+        return -1;
+    if (overdraw && optimizeOverdraw(mesh->indices, mesh->numIndices, mesh->vertices, mesh->numVertices) != 0)
+        return -1;
+    if (optimizeVertexFetch(mesh->vertices, mesh->indices, mesh->numIndices, mesh->numVertices) != 0)
+        return -1;
+    if (after)
+        *after = analyzeVertexCache(mesh->indices, mesh->numIndices, mesh->numVertices, MESHOPT_CACHE_SIZE);
+    return 0;
+}
+
+typedef struct
+{
+    double m[10]; // Симметричная 4x4: a2 ab ac ad b2 bc bd c2 cd d2
+} Quadric;
+
+typedef struct
+{
+    unsigned int from, to;
+    float cost;
+} Collapse;
+
+static void quadricAddPlane(Quadric* q, double a, double b, double c, double d, double w)
+{
+    q->m[0] += w * a * a; q->m[1] += w * a * b; q->m[2] += w * a * c; q->m[3] += w * a * d;
+    q->m[4] += w * b * b; q->m[5] += w * b * c; q->m[6] += w * b * d;
+    q->m[7] += w * c * c; q->m[8] += w * c * d;
+    q->m[9] += w * d * d;
+}
+
+// Квадрат расстояния от точки до плоскостей, накопленных в сумме двух квадрик
+static double quadricError2(const Quadric* qa, const Quadric* qb, const float* p)
+{
+    double m[10];
+    for (int i = 0; i < 10; i++)
+        m[i] = qa->m[i] + qb->m[i];
+    double x = p[0], y = p[1], z = p[2];
+    double e = m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x +
+               m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y +
+               m[7] * z * z + 2 * m[8] * z + m[9];
+    return e < 0 ? 0 : e;
+}
+
+static int compareCollapses(const void* a, const void* b)
+{
+    const Collapse* ca = a;
+    const Collapse* cb = b;
+    if (ca->cost != cb->cost)
+        return ca->cost < cb->cost ? -1 : 1;
+    if (ca->from != cb->from)
+        return ca->from < cb->from ? -1 : 1;
+    return ca->to < cb->to ? -1 : (ca->to > cb->to);
+}
+
+static int compareU64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : (x > y);
+}
+
+static uint32_t hashPosition(const float* p)
+{
+    uint32_t h = 2166136261u;
+    const unsigned char* bytes = (const unsigned char*)p;
+    for (int i = 0; i < 12; i++)
+        h = (h ^ bytes[i]) * 16777619u;
+    return h;
+}
+
+static void faceNormal(const float* a, const float* b, const float* c, double* n)
+{
+    double e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    double e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// Позиционные id (вершины шва UV получают общий id) и флаги блокировки: швы и границы не двигаются
+static int buildSimplifyTopology(const float* vertices, unsigned int numVertices, const unsigned int* indices,
+                                 unsigned int numIndices, unsigned int* posId, char* locked)
+{
+    size_t capacity = 16;
+    while (capacity < (size_t)numVertices * 2)
+        capacity <<= 1;
+    uint32_t* table = malloc(capacity * sizeof(uint32_t));
+    unsigned int* shared = calloc(numVertices, sizeof(unsigned int));
+    uint64_t* edges = malloc((numIndices ? numIndices : 1) * sizeof(uint64_t));
+    if (!table || !shared || !edges)
+    {
+        free(table); free(shared); free(edges);
+        return -1;
+    }
+    memset(table, 0xFF, capacity * sizeof(uint32_t));
+    for (unsigned int v = 0; v < numVertices; v++)
+    {
+        const float* p = vertices + (size_t)v * MESH_VERTEX_FLOATS;
+        size_t slot = hashPosition(p) & (capacity - 1);
+        while (table[slot] != 0xFFFFFFFFu && memcmp(vertices + (size_t)table[slot] * MESH_VERTEX_FLOATS, p, 12) != 0)
+            slot = (slot + 1) & (capacity - 1);
+        if (table[slot] == 0xFFFFFFFFu)
+            table[slot] = v;
+        posId[v] = table[slot];
+        shared[posId[v]]++;
+    }
+    // Ребра в пространстве позиций; ребро, встреченное один раз - граница
+    unsigned int numEdges = 0;
+    for (unsigned int i = 0; i < numIndices; i += 3)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int a = posId[indices[i + k]], b = posId[indices[i + (k + 1) % 3]];
+            if (a == b)
+                continue;
+            edges[numEdges++] = a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+        }
+    }
+    qsort(edges, numEdges, sizeof(uint64_t), compareU64);
+    for (unsigned int i = 0; i < numEdges;)
+    {
+        unsigned int j = i + 1;
+        while (j < numEdges && edges[j] == edges[i])
+            j++;
+        if (j - i == 1)
+        {
+            shared[edges[i] >> 32] = 2;
+            shared[(unsigned int)edges[i]] = 2;
+        }
+        i = j;
+    }
+    for (unsigned int v = 0; v < numVertices; v++)
+        locked[v] = shared[posId[v]] > 1;
+    free(table); free(shared); free(edges);
+    return 0;
+}
+
+unsigned int simplifyMesh(const float* vertices, unsigned int numVertices, const unsigned int* indices,
+                          unsigned int numIndices, unsigned int targetIndices, float maxError, unsigned int* out)
+{
+    unsigned int* posId = malloc((numVertices ? numVertices : 1) * sizeof(unsigned int));
+    char* locked = malloc(numVertices ? numVertices : 1);
+    char* touched = malloc(numVertices ? numVertices : 1);
+    unsigned int* remap = malloc((numVertices ? numVertices : 1) * sizeof(unsigned int));
+    unsigned int* offsets = malloc((numVertices + 1) * sizeof(unsigned int));
+    unsigned int* adjacency = malloc((numIndices ? numIndices : 1) * sizeof(unsigned int));
+    Quadric* quadrics = calloc(numVertices ? numVertices : 1, sizeof(Quadric));
+    Collapse* collapses = malloc((numIndices ? numIndices : 1) * 2 * sizeof(Collapse));
+    unsigned int count = numIndices;
+    memcpy(out, indices, numIndices * sizeof(unsigned int));
+    if (!posId || !locked || !touched || !remap || !offsets || !adjacency || !quadrics || !collapses ||
+        buildSimplifyTopology(vertices, numVertices, indices, numIndices, posId, locked) != 0)
+        goto done;
+
+    // Квадрики плоскостей треугольников, взвешенные по площади, копятся на позиционных id
+    for (unsigned int i = 0; i < numIndices; i += 3)
+    {
+        const float* a = vertices + (size_t)indices[i] * MESH_VERTEX_FLOATS;
+        const float* b = vertices + (size_t)indices[i + 1] * MESH_VERTEX_FLOATS;
+        const float* c = vertices + (size_t)indices[i + 2] * MESH_VERTEX_FLOATS;
+        double n[3];
+        faceNormal(a, b, c, n);
+        double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len <= 0)
+            continue;
+        double d = -(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]) / len;
+        for (int k = 0; k < 3; k++)
+            quadricAddPlane(&quadrics[posId[indices[i + k]]], n[0] / len, n[1] / len, n[2] / len, d, len * 0.5);
+    }
+
+    double maxError2 = (double)maxError * maxError;
+    while (count > targetIndices)
+    {
+        // Кандидаты: ребро (from -> to), двигается только незаблокированная вершина
+        unsigned int numCollapses = 0;
+        for (unsigned int i = 0; i < count; i += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int a = out[i + k], b = out[i + (k + 1) % 3];
+                if (posId[a] == posId[b])
+                    continue;
+                for (int dir = 0; dir < 2; dir++)
+                {
+                    unsigned int from = dir ? b : a, to = dir ? a : b;
+                    if (locked[from])
+                        continue;
+                    double e = quadricError2(&quadrics[posId[from]], &quadrics[posId[to]],
+                                             vertices + (size_t)to * MESH_VERTEX_FLOATS);
+                    if (e > maxError2)
+                        continue;
+                    collapses[numCollapses].from = from;
+                    collapses[numCollapses].to = to;
+                    collapses[numCollapses].cost = (float)e;
+                    numCollapses++;
+                }
+            }
+        }
+        if (numCollapses == 0)
+            break;
+        qsort(collapses, numCollapses, sizeof(Collapse), compareCollapses);
+
+        // Треугольники каждой вершины для проверки переворота
+        memset(offsets, 0, (numVertices + 1) * sizeof(unsigned int));
+        for (unsigned int i = 0; i < count; i++)
+            offsets[out[i] + 1]++;
+        for (unsigned int v = 0; v < numVertices; v++)
+            offsets[v + 1] += offsets[v];
+        for (unsigned int i = 0; i < count; i++)
+            adjacency[offsets[out[i]]++] = i / 3;
+        for (unsigned int v = numVertices; v > 0; v--)
+            offsets[v] = offsets[v - 1];
+        offsets[0] = 0;
+
+        for (unsigned int v = 0; v < numVertices; v++)
+            remap[v] = v;
+        memset(touched, 0, numVertices);
+        unsigned int removed = 0, applied = 0;
+        for (unsigned int c = 0; c < numCollapses && count - removed * 3 > targetIndices; c++)
+        {
+            unsigned int from = collapses[c].from, to = collapses[c].to;
+            if (touched[from] || touched[to])
+                continue;
+            const float* pt = vertices + (size_t)to * MESH_VERTEX_FLOATS;
+            int flips = 0;
+            unsigned int degenerate = 0;
+            for (unsigned int j = offsets[from]; j < offsets[from + 1] && !flips; j++)
+            {
+                const unsigned int* tri = &out[adjacency[j] * 3];
+                if (posId[tri[0]] == posId[to] || posId[tri[1]] == posId[to] || posId[tri[2]] == posId[to])
+                {
+                    degenerate++;
+                    continue;
+                }
+                const float* p[3];
+                for (int k = 0; k < 3; k++)
+                    p[k] = vertices + (size_t)tri[k] * MESH_VERTEX_FLOATS;
+                double n0[3], n1[3];
+                faceNormal(p[0], p[1], p[2], n0);
+                for (int k = 0; k < 3; k++)
+                    if (tri[k] == from)
+                        p[k] = pt;
+                faceNormal(p[0], p[1], p[2], n1);
+                flips = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0;
+            }
+            if (flips)
+                continue;
+
+            // Принято: соседи замораживаются до следующего прохода, чтобы схлопывания были независимы
+            for (unsigned int j = offsets[from]; j < offsets[from + 1]; j++)
+                for (int k = 0; k < 3; k++)
+                    touched[out[adjacency[j] * 3 + k]] = 1;
+            touched[to] = 1;
+            remap[from] = to;
+            for (int i = 0; i < 10; i++)
+                quadrics[posId[to]].m[i] += quadrics[posId[from]].m[i];
+            removed += degenerate;
+            applied++;
+        }
+        if (applied == 0)
+            break;
+
+        // Перенумерация и удаление вырожденных треугольников
+        unsigned int written = 0;
+        for (unsigned int i = 0; i < count; i += 3)
+        {
+            unsigned int a = remap[out[i]], b = remap[out[i + 1]], c = remap[out[i + 2]];
+            if (posId[a] == posId[b] || posId[b] == posId[c] || posId[a] == posId[c])
+                continue;
+            out[written++] = a;
+            out[written++] = b;
+            out[written++] = c;
+        }
+        count = written;
+    }
+
+done:
+    free(posId); free(locked); free(touched); free(remap);
+    free(offsets); free(adjacency); free(quadrics); free(collapses);
+    return count;
+}
+
+int generateMeshLods(Mesh* mesh, const float* ratios, unsigned int numLods, float maxError)
+{
+    if (numLods > MESH_MAX_LODS)
+        numLods = MESH_MAX_LODS;
+    unsigned int base = mesh->lodCount[0] ? mesh->lodCount[0] : mesh->numIndices;
+    size_t total = base;
+    for (unsigned int l = 1; l < numLods; l++)
+        total += base;
+    unsigned int* indices = realloc(mesh->indices, total * sizeof(unsigned int));
+    if (!indices)
+        return -1;
+    mesh->indices = indices;
+    mesh->numLods = 1;
+    mesh->lodOffset[0] = 0;
+    mesh->lodCount[0] = base;
+
+    // Каждый уровень упрощается из предыдущего и переупорядочивается под кеш вершин
+    unsigned int offset = base;
+    for (unsigned int l = 1; l < numLods; l++)
+    {
+        const unsigned int* prev = indices + mesh->lodOffset[l - 1];
+        unsigned int prevCount = mesh->lodCount[l - 1];
+        unsigned int target = (unsigned int)(base / 3 * ratios[l]) * 3;
+        unsigned int count = simplifyMesh(mesh->vertices, mesh->numVertices, prev, prevCount, target, maxError,
+                                          indices + offset);
+        if (count >= prevCount)
+            break; // Дальше упрощать нечего
+        optimizeVertexCache(indices + offset, count, mesh->numVertices);
+        mesh->lodOffset[l] = offset;
+        mesh->lodCount[l] = count;
+        mesh->numLods++;
+        offset += count;
+    }
+    mesh->numIndices = offset;
+    unsigned int* shrunk = realloc(mesh->indices, (offset ? offset : 1) * sizeof(unsigned int));
+    if (shrunk)
+        mesh->indices = shrunk;
+    return 0;
+}
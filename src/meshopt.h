@@ -0,0 +1,33 @@
+#ifndef MESHOPT_H
+#define MESHOPT_H
+
+#include "mesh.h"
+
+#define MESHOPT_CACHE_SIZE 32 // Размер моделируемого FIFO кеша вершин после трансформации
+
+typedef struct {
+    float acmr; // Промахов кеша на треугольник (0.5 - идеал, 3 - без переиспользования)
+    float atvr; // Промахов кеша на вершину (1 - идеал)
+} MeshCacheStats;
+
+// Моделирование FIFO кеша вершин заданного размера
+MeshCacheStats analyzeVertexCache(const unsigned int* indices, unsigned int numIndices, unsigned int numVertices, unsigned int cacheSize);
+// Перестановка треугольников под кеш вершин (алгоритм Форсайта). 0 при успехе
+int optimizeVertexCache(unsigned int* indices, unsigned int numIndices, unsigned int numVertices);
+// Перестановка кластеров треугольников (границы - где кеш начинается с нуля) от внешних к внутренним
+int optimizeOverdraw(unsigned int* indices, unsigned int numIndices, const float* vertices, unsigned int numVertices);
+// Вершины в порядке первого использования, индексы перенумеровываются. 0 при успехе
+int optimizeVertexFetch(float* vertices, unsigned int* indices, unsigned int numIndices, unsigned int numVertices);
+
+#define MESHOPT_LOD_MAX_ERROR 0.02f // Допустимое отклонение поверхности LOD, доля диагонали AABB
+
+// Упрощение схлопыванием ребер по квадрикам ошибки (QEM). Швы UV и границы не двигаются.
+// Пишет в out (не меньше numIndices) и возвращает число индексов; maxError - в единицах позиции
+unsigned int simplifyMesh(const float* vertices, unsigned int numVertices, const unsigned int* indices, unsigned int numIndices, unsigned int targetIndices, float maxError, unsigned int* out);
+// Цепочка LOD: ratios[l] - доля треугольников LOD0, каждый уровень упрощается из предыдущего
+int generateMeshLods(Mesh* mesh, const float* ratios, unsigned int numLods, float maxError);
+
+// Весь проход для меша: кеш, затем (опционально) overdraw, затем порядок вершин
+int optimizeMesh(Mesh* mesh, int overdraw, MeshCacheStats* before, MeshCacheStats* after);
+
+#endif
@@ -0,0 +1,112 @@
+// Бенчмарк разбора OBJ: ./objbench [путь] [повторов] [потоков] [--verify]
+// --verify сравнивает параллельный разбор с последовательным побайтно
+// Сборка: gcc -O2 objbench.c objload.c -I../include -o objbench -lm -pthread
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "objload.h"
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int sameArray(const void* a, const void* b, unsigned int count, size_t elem)
+{
+    return count == 0 || memcmp(a, b, count * elem) == 0;
+}
+
+// Проверка: параллельный разбор при разном числе потоков дает те же байты, что и последовательный
+static int verify(const char* data, size_t size)
+{
+    Model ref;
+    memset(&ref, 0, sizeof(ref));
+    parseObj(data, size, &ref, .05f, 0.2f, 1.0f, -0.3f, 0);
+    int failed = 0;
+    for (int threads = 2; threads <= 16; threads *= 2) {
+        Model m;
+        memset(&m, 0, sizeof(m));
+        parseObjParallel(data, size, &m, .05f, 0.2f, 1.0f, -0.3f, 0, threads);
+        int ok = m.numVertices == ref.numVertices && m.numTexCoords == ref.numTexCoords &&
+                 m.numNormals == ref.numNormals && m.numFaces == ref.numFaces &&
+                 sameArray(m.vertices, ref.vertices, m.numVertices, sizeof(vec3)) &&
+                 sameArray(m.texCoords, ref.texCoords, m.numTexCoords, sizeof(vec2)) &&
+                 sameArray(m.normals, ref.normals, m.numNormals, sizeof(vec3)) &&
+                 sameArray(m.faces, ref.faces, m.numFaces, sizeof(Face));
+        printf("verify %2d threads: %s\n", threads, ok ? "OK" : "MISMATCH");
+        failed |= !ok;
+        freeModel(&m);
+    }
+    freeModel(&ref);
+    return failed;
+}
+
+int main(int argc, char** argv)
+{
+    const char* args[3] = {"../res/fighter.obj", "50", "0"};
+    int nargs = 0, doVerify = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--verify") == 0)
+            doVerify = 1;
+        else if (nargs < 3)
+            args[nargs++] = argv[i];
+    }
+    const char* path = args[0];
+    int runs = atoi(args[1]);
+    int threads = atoi(args[2]);
+    if (runs < 1)
+        runs = 1;
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        printf("Failed to open OBJ file: %s\n", path);
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+    const char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("Failed to map OBJ file: %s\n", path);
+        return 1;
+    }
+
+    if (doVerify && verify(data, size)) {
+        munmap((void*)data, size);
+        return 1;
+    }
+
+    Model m; // Прогрев: страницы файла уже в памяти, меряется только разбор
+    memset(&m, 0, sizeof(m));
+    parseObj(data, size, &m, .05f, 0.2f, 1.0f, -0.3f, 0);
+    printf("%s: %u vertices, %u uvs, %u normals, %u triangles\n", path, m.numVertices, m.numTexCoords,
+           m.numNormals, m.numFaces / 3);
+    freeModel(&m);
+
+    double best = 1e30, total = 0;
+    for (int i = 0; i < runs; i++) {
+        memset(&m, 0, sizeof(m));
+        double t0 = now();
+        parseObjParallel(data, size, &m, .05f, 0.2f, 1.0f, -0.3f, 0, threads);
+        double t = now() - t0;
+        freeModel(&m);
+        total += t;
+        if (t < best)
+            best = t;
+    }
+    double mb = size / (1024.0 * 1024.0);
+    printf("%d threads, %d runs, %.2f MB: avg %.3f ms (%.1f MB/s), best %.3f ms (%.1f MB/s)\n",
+           threads > 0 ? threads : objDefaultThreads(size), runs, mb,
+           total / runs * 1e3, mb * runs / total, best * 1e3, mb / best);
+
+    munmap((void*)data, size);
+    return 0;
+}
@@ -0,0 +1,447 @@
+#include "objload.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define OBJ_MAX_THREADS 64
+#define OBJ_MIN_CHUNK (256 * 1024) // Меньше куски не окупают запуск потока
+
+typedef struct { // Позиции записи: для куска - смещения, полученные префиксной суммой
+    size_t numVertices;
+    size_t numTexCoords;
+    size_t numNormals;
+    size_t numFaces;
+} ObjCounts;
+
+typedef struct {
+    float scale, zoffset, ydir, yoffset;
+    int change;
+} ObjParams;
+
+typedef struct {
+    const char* begin;
+    const char* end;
+    Model* model;
+    ObjCounts at;
+    const ObjParams* params;
+    int countOnly;
+} ObjChunk;
+
+// Степени 10, точные во float (5^10 < 2^24)
+static const float pow10tab[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+static const char* skipSpaces(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+static const char* skipLine(const char* p, const char* end)
+{
+    const char* nl = memchr(p, '\n', end - p);
+    return nl ? nl + 1 : end;
+}
+
+// Медленный путь для редких чисел (много цифр, большие степени, inf/nan)
+static const char* parseFloatSlow(const char* p, const char* end, float* out)
+{
+    char buf[64];
+    size_t n = 0;
+    while (p + n < end && n < sizeof(buf) - 1 && p[n] != ' ' && p[n] != '\t' && p[n] != '\r' && p[n] != '\n')
+        n++;
+    memcpy(buf, p, n);
+    buf[n] = '\0';
+    char* stop;
+    *out = strtof(buf, &stop);
+    return p + (stop - buf);
+}
+
+// Разбор float без локали и форматной строки. Быстрый путь - когда мантисса и степень 10 точны во float: тогда одно
+// умножение или деление округляется так же, как strtof (до 7 значащих цифр, как пишет Blender). Остальное - strtof
+static const char* parseFloat(const char* p, const char* end, float* out)
+{
+    const char* start = p;
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = *p++ == '-';
+    uint64_t mant = 0;
+    int digits = 0, exp10 = 0, anyDigits = 0;
+    while (p < end && (unsigned)(*p - '0') < 10) {
+        anyDigits = 1;
+        if (digits < 19) {
+            mant = mant * 10 + (*p - '0');
+            digits += mant != 0;
+        } else {
+            exp10++;
+        }
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && (unsigned)(*p - '0') < 10) {
+            if (digits < 19) {
+                mant = mant * 10 + (*p - '0');
+                digits += mant != 0;
+                exp10--;
+            }
+            p++;
+            anyDigits = 1;
+        }
+    }
+    if (!anyDigits)
+        return parseFloatSlow(start, end, out);
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        int eneg = 0, e = 0;
+        if (q < end && (*q == '-' || *q == '+'))
+            eneg = *q++ == '-';
+        if (q < end && (unsigned)(*q - '0') < 10) {
+            while (q < end && (unsigned)(*q - '0') < 10) {
+                if (e < 10000)
+                    e = e * 10 + (*q - '0');
+                q++;
+            }
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+    if (mant > (1ull << 24) || exp10 > 10 || exp10 < -10)
+        return parseFloatSlow(start, end, out);
+    float v = (float)mant;
+    v = exp10 < 0 ? v / pow10tab[-exp10] : v * pow10tab[exp10];
+    *out = (float)(neg ? -v : v);
+    return p;
+}
+
+static const char* parseInt(const char* p, const char* end, long* out)
+{
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = *p++ == '-';
+    long v = 0;
+    const char* digitsStart = p;
+    while (p < end && (unsigned)(*p - '0') < 10) {
+        if (v < 1000000000L)
+            v = v * 10 + (*p - '0');
+        p++;
+    }
+    if (p == digitsStart) {
+        *out = 0;
+        return p;
+    }
+    *out = neg ? -v : v;
+    return p;
+}
+
+// Индекс OBJ: положительный с 1, отрицательный - от конца уже прочитанных элементов
+// Ссылки за пределы массивов становятся OBJ_BAD_INDEX и отлавливаются после разбора
+#define OBJ_BAD_INDEX (OBJ_NO_INDEX - 1)
+
+static unsigned int resolveIndex(long idx, size_t count)
+{
+    if (idx > 0)
+        return idx - 1 < (long)OBJ_BAD_INDEX ? (unsigned int)(idx - 1) : OBJ_BAD_INDEX;
+    if (idx < 0)
+        return (long)count + idx >= 0 ? (unsigned int)((long)count + idx) : OBJ_BAD_INDEX;
+    return OBJ_NO_INDEX;
+}
+
+// Угол грани: v, v/vt, v//vn или v/vt/vn
+static const char* parseCorner(const char* p, const char* end, const ObjCounts* at, Face* out)
+{
+    long v = 0, vt = 0, vn = 0;
+    p = parseInt(p, end, &v);
+    if (p < end && *p == '/') {
+        p++;
+        if (p < end && *p != '/')
+            p = parseInt(p, end, &vt);
+        if (p < end && *p == '/')
+            p = parseInt(p + 1, end, &vn);
+    }
+    out->vertexIndex = resolveIndex(v, at->numVertices);
+    out->uvIndex = resolveIndex(vt, at->numTexCoords);
+    out->normalIndex = resolveIndex(vn, at->numNormals);
+    return p;
+}
+
+static int isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// Разбор строк [p, end). countOnly - только подсчет элементов (первый проход параллельного разбора)
+static void parseRange(const char* p, const char* end, Model* obmodel, ObjCounts* at, const ObjParams* prm, int countOnly)
+{
+    int y = 1;
+    int z = 2;
+    if (prm->change) { // Если перепутаны y и z
+        z = 1;
+        y = 2;
+    }
+    while (p < end) {
+        p = skipSpaces(p, end);
+        if (end - p < 2) {
+            break;
+        }
+        if (p[0] == 'v' && isSpace(p[1])) {
+            if (!countOnly) {
+                float* vert = obmodel->vertices[at->numVertices];
+                p = parseFloat(skipSpaces(p + 2, end), end, &vert[0]);
+                p = parseFloat(skipSpaces(p, end), end, &vert[y]);
+                p = parseFloat(skipSpaces(p, end), end, &vert[z]);
+
+                vert[0] *= prm->scale; // Смещения и масштаб
+                vert[z] *= prm->scale;
+                vert[y] *= (prm->scale * prm->ydir);
+                vert[1] += prm->zoffset;
+                vert[1] += prm->yoffset;
+            }
+            at->numVertices++;
+        } else if (p[0] == 'v' && p[1] == 't' && end - p > 2 && isSpace(p[2])) {
+            // Текстурная координата
+            if (!countOnly) {
+                float* uv = obmodel->texCoords[at->numTexCoords];
+                p = parseFloat(skipSpaces(p + 3, end), end, &uv[0]);
+                p = parseFloat(skipSpaces(p, end), end, &uv[1]);
+            }
+            at->numTexCoords++;
+        } else if (p[0] == 'v' && p[1] == 'n' && end - p > 2 && isSpace(p[2])) {
+            // Нормаль
+            if (!countOnly) {
+                float* n = obmodel->normals[at->numNormals];
+                p = parseFloat(skipSpaces(p + 3, end), end, &n[0]);
+                p = parseFloat(skipSpaces(p, end), end, &n[1]);
+                p = parseFloat(skipSpaces(p, end), end, &n[2]);
+            }
+            at->numNormals++;
+        } else if (p[0] == 'f' && isSpace(p[1])) {
+            // Грань: веер треугольников (0,1,2), (0,2,3), ...
+            Face first, prev, cur;
+            int corners = 0;
+            p = skipSpaces(p + 2, end);
+            while (p < end && *p != '\n' && *p != '\r' && *p != '#') {
+                const char* next = parseCorner(p, end, at, &cur);
+                if (next == p)
+                    break;
+                p = skipSpaces(next, end);
+                if (corners == 0) {
+                    first = cur;
+                } else if (corners >= 2) {
+                    if (!countOnly) {
+                        obmodel->faces[at->numFaces] = first;
+                        obmodel->faces[at->numFaces + 1] = prev;
+                        obmodel->faces[at->numFaces + 2] = cur;
+                    }
+                    at->numFaces += 3;
+                }
+                prev = cur;
+                corners++;
+            }
+        }
+        p = skipLine(p, end);
+    }
+}
+
+static void* parseChunk(void* arg)
+{
+    ObjChunk* c = arg;
+    parseRange(c->begin, c->end, c->model, &c->at, c->params, c->countOnly);
+    return NULL;
+}
+
+static void runChunks(ObjChunk* chunks, int count)
+{
+    pthread_t threads[OBJ_MAX_THREADS];
+    int started[OBJ_MAX_THREADS] = {0};
+    for (int i = 1; i < count; i++)
+        started[i] = pthread_create(&threads[i], NULL, parseChunk, &chunks[i]) == 0;
+    parseChunk(&chunks[0]); // Первый кусок - в текущем потоке
+    for (int i = 1; i < count; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            parseChunk(&chunks[i]);
+    }
+}
+
+int objDefaultThreads(size_t size)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t bySize = size / OBJ_MIN_CHUNK;
+    long threads = cpus < (long)bySize ? cpus : (long)bySize;
+    if (threads > OBJ_MAX_THREADS)
+        threads = OBJ_MAX_THREADS;
+    return threads < 1 ? 1 : (int)threads;
+}
+
+static void* allocArray(size_t count, size_t elem)
+{
+    return malloc(count ? count * elem : elem);
+}
+
+// Индексы граней проверяются после разбора: положительные ссылки вперед в OBJ допустимы
+static int validateFaces(const Model* m)
+{
+    for (unsigned int i = 0; i < m->numFaces; i++) {
+        const Face* f = &m->faces[i];
+        if (f->vertexIndex >= m->numVertices ||
+            (f->uvIndex != OBJ_NO_INDEX && f->uvIndex >= m->numTexCoords) ||
+            (f->normalIndex != OBJ_NO_INDEX && f->normalIndex >= m->numNormals)) {
+            printf("OBJ face %u references a missing vertex/uv/normal\n", i / 3);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Два прохода: подсчет элементов по кускам, затем разбор прямо в массивы точного размера
+static int parseChunks(const char* data, size_t size, Model* obmodel, const ObjParams* prm, int threads)
+{
+    if (threads < 1)
+        threads = 1;
+    if (threads > OBJ_MAX_THREADS)
+        threads = OBJ_MAX_THREADS;
+
+    // Куски выравниваются по началу строки
+    ObjChunk chunks[OBJ_MAX_THREADS];
+    const char* end = data + size;
+    const char* p = data;
+    int count = 0;
+    for (int i = 0; i < threads && (p < end || count == 0); i++) {
+        const char* stop = i == threads - 1 ? end : data + size / threads * (i + 1);
+        if (stop < p)
+            stop = p;
+        if (stop < end)
+            stop = skipLine(stop, end);
+        chunks[count].begin = p;
+        chunks[count].end = stop;
+        chunks[count].model = obmodel;
+        chunks[count].params = prm;
+        chunks[count].countOnly = 1;
+        memset(&chunks[count].at, 0, sizeof(ObjCounts));
+        count++;
+        p = stop;
+    }
+
+    // Проход 1: подсчет элементов в каждом куске
+    runChunks(chunks, count);
+
+    // Префиксная сумма: с какого индекса пишет каждый кусок
+    ObjCounts total = {0, 0, 0, 0};
+    for (int i = 0; i < count; i++) {
+        ObjCounts local = chunks[i].at;
+        chunks[i].at = total;
+        chunks[i].countOnly = 0;
+        total.numVertices += local.numVertices;
+        total.numTexCoords += local.numTexCoords;
+        total.numNormals += local.numNormals;
+        total.numFaces += local.numFaces;
+    }
+    if (total.numVertices >= OBJ_BAD_INDEX || total.numTexCoords >= OBJ_BAD_INDEX ||
+        total.numNormals >= OBJ_BAD_INDEX || total.numFaces >= OBJ_BAD_INDEX) {
+        printf("OBJ is too large: %zu vertices, %zu uvs, %zu normals, %zu face corners\n", total.numVertices,
+               total.numTexCoords, total.numNormals, total.numFaces);
+        return -1;
+    }
+
+    obmodel->vertices = allocArray(total.numVertices, sizeof(vec3));
+    obmodel->texCoords = allocArray(total.numTexCoords, sizeof(vec2));
+    obmodel->normals = allocArray(total.numNormals, sizeof(vec3));
+    obmodel->faces = allocArray(total.numFaces, sizeof(Face));
+    if (!obmodel->vertices || !obmodel->texCoords || !obmodel->normals || !obmodel->faces) {
+        printf("Out of memory while loading OBJ\n");
+        freeModel(obmodel);
+        return -1;
+    }
+
+    // Проход 2: разбор прямо в итоговые массивы; отрицательные индексы считаются от смещения куска
+    runChunks(chunks, count);
+
+    obmodel->numVertices = (unsigned int)total.numVertices;
+    obmodel->numTexCoords = (unsigned int)total.numTexCoords;
+    obmodel->numNormals = (unsigned int)total.numNormals;
+    obmodel->numFaces = (unsigned int)total.numFaces;
+    if (validateFaces(obmodel) != 0) {
+        freeModel(obmodel);
+        return -1;
+    }
+    return 0;
+}
+
+int parseObj(const char* data, size_t size, Model* obmodel, float scale, float zoffset, float ydir, float yoffset, int change)
+{
+    ObjParams prm = {scale, zoffset, ydir, yoffset, change};
+    return parseChunks(data, size, obmodel, &prm, 1);
+}
+
+int parseObjParallel(const char* data, size_t size, Model* obmodel, float scale, float zoffset, float ydir, float yoffset, int change, int threads)
+{
+    ObjParams prm = {scale, zoffset, ydir, yoffset, change};
+    if (threads <= 0)
+        threads = objDefaultThreads(size);
+    return parseChunks(data, size, obmodel, &prm, threads);
+}
+
+int loadObj(const char* path, Model* obmodel, float scale, float zoffset, float ydir, float yoffset, int change)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Failed to open OBJ file: %s\n", path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        printf("Failed to open OBJ file: %s\n", path);
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    const char* data = "";
+    void* map = NULL;
+    if (size) {
+        map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            printf("Failed to map OBJ file: %s\n", path);
+            close(fd);
+            return -1;
+        }
+        madvise(map, size, MADV_SEQUENTIAL);
+        data = map;
+    }
+    close(fd);
+
+    int result = parseObjParallel(data, size, obmodel, scale, zoffset, ydir, yoffset, change, 0);
+    if (map)
+        munmap(map, size);
+    return result;
+}
+
+void freeModelData(Model* obmodel)
+{
+    free(obmodel->vertices);
+    free(obmodel->texCoords);
+    free(obmodel->normals);
+    free(obmodel->faces);
+    obmodel->vertices = NULL;
+    obmodel->texCoords = NULL;
+    obmodel->normals = NULL;
+    obmodel->faces = NULL;
+}
+
+void freeModel(Model* obmodel)
+{
+    freeModelData(obmodel);
+
+    obmodel->numVertices = 0;
+    obmodel->numTexCoords = 0;
+    obmodel->numNormals = 0;
+    obmodel->numFaces = 0;
+}
@@ -0,0 +1,43 @@
+#ifndef OBJLOAD_H
+#define OBJLOAD_H
+
+#include <stddef.h>
+#include <cglm/cglm.h>
+
+#define OBJ_NO_INDEX 0xFFFFFFFFu // Нет текстурной координаты / нормали (v, v//vn, v/vt)
+
+typedef struct {
+    unsigned int vertexIndex;
+    unsigned int uvIndex;
+    unsigned int normalIndex;
+} Face;
+
+typedef struct {
+    vec3* vertices;
+    vec2* texCoords;
+    vec3* normals;
+    Face* faces;
+
+    unsigned int numVertices;
+    unsigned int numTexCoords;
+    unsigned int numNormals;
+    unsigned int numFaces;
+
+    vec3 boundsMin;
+    vec3 boundsMax;
+} Model;
+
+// Разбор OBJ из буфера в памяти (не обязательно завершенного нулем). 0 при успехе.
+// Массивы выделяются точно по размеру меша после прохода подсчета; битые индексы граней - ошибка
+int parseObj(const char* data, size_t size, Model* obmodel, float scale, float zoffset, float ydir, float yoffset, int change);
+// То же, разбитое на куски по строкам и разобранное threads потоками (0 - по числу ядер и размеру).
+// Результат побитово совпадает с parseObj
+int parseObjParallel(const char* data, size_t size, Model* obmodel, float scale, float zoffset, float ydir, float yoffset, int change, int threads);
+int objDefaultThreads(size_t size);
+// Отображает файл в память через mmap и разбирает его. 0 при успехе
+int loadObj(const char* path, Model* obmodel, float scale, float zoffset, float ydir, float yoffset, int change);
+// Освобождает массивы, но оставляет счетчики и границы (нужны для отрисовки после загрузки в VBO)
+void freeModelData(Model* obmodel);
+void freeModel(Model* obmodel);
+
+#endif
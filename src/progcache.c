@@ -0,0 +1,129 @@
+#include "progcache.h"
+#include "cook.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+_Static_assert(sizeof(ProgCacheHeader) == 24, "ProgCacheHeader layout is part of the .g3dp format");
+
+typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+static GetProgramBinaryProc getProgramBinary;
+static ProgramBinaryProc programBinary;
+static ProgramParameteriProc programParameteri;
+static MaxShaderCompilerThreadsProc maxShaderCompilerThreads;
+
+void programCacheInit(GLADloadproc load, int binary, int parallel)
+{
+    int formats = 0;
+    if (binary)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats > 0) { // Расширение без форматов - бинарники не сохраняются
+        getProgramBinary = (GetProgramBinaryProc)load("glGetProgramBinary");
+        programBinary = (ProgramBinaryProc)load("glProgramBinary");
+        programParameteri = (ProgramParameteriProc)load("glProgramParameteri");
+    }
+    if (parallel) {
+        maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)load("glMaxShaderCompilerThreadsKHR");
+        if (!maxShaderCompilerThreads)
+            maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)load("glMaxShaderCompilerThreadsARB");
+    }
+}
+
+int programCacheEnabled(void)
+{
+    return getProgramBinary && programBinary && programParameteri;
+}
+
+int parallelShaderCompile(void)
+{
+    if (!maxShaderCompilerThreads)
+        return 0;
+    maxShaderCompilerThreads(0xFFFFFFFFu); // Столько потоков, сколько решит драйвер
+    return 1;
+}
+
+uint64_t programCacheKey(const void* vertex, size_t vertexSize, const void* fragment, size_t fragmentSize)
+{
+    uint64_t h = hashContent(vertex, vertexSize);
+    h = cookKey(h, fragment, fragmentSize);
+    const GLenum names[3] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (int i = 0; i < 3; i++) {
+        const char* s = (const char*)glGetString(names[i]);
+        h = cookKey(h, s ? s : "", s ? strlen(s) : 0);
+    }
+    uint32_t version = PROGCACHE_VERSION;
+    return cookKey(h, &version, sizeof(version));
+}
+
+int loadProgramBinary(const char* cachePath, uint64_t key, unsigned int program)
+{
+    const void* data;
+    size_t size;
+    if (!programCacheEnabled() || mapFile(cachePath, &data, &size) != 0)
+        return 0;
+    const ProgCacheHeader* h = data;
+    int ok = size >= sizeof(ProgCacheHeader) && memcmp(h->magic, PROGCACHE_MAGIC, 4) == 0 &&
+             h->version == PROGCACHE_VERSION && h->key == key && size == sizeof(ProgCacheHeader) + h->size;
+    if (ok) {
+        programBinary(program, h->binaryFormat, h + 1, (GLsizei)h->size);
+        int status = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &status); // После обновления драйвера бинарник может быть отвергнут
+        ok = status;
+    }
+    unmapFile(data, size);
+    return ok;
+}
+
+void programBinaryHint(unsigned int program)
+{
+    if (programCacheEnabled())
+        programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void saveProgramBinary(const char* cachePath, uint64_t key, unsigned int program)
+{
+    if (!programCacheEnabled())
+        return;
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    void* binary = length > 0 ? malloc(length) : NULL;
+    if (!binary)
+        return;
+    ProgCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PROGCACHE_MAGIC, 4);
+    h.version = PROGCACHE_VERSION;
+    h.key = key;
+    GLsizei written = 0;
+    GLenum format = 0;
+    getProgramBinary(program, length, &written, &format, binary);
+    h.binaryFormat = format;
+    h.size = (uint32_t)written;
+
+    char tmpPath[620];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", cachePath);
+    FILE* file = written > 0 && makeParentDir(cachePath) == 0 ? fopen(tmpPath, "wb") : NULL;
+    int ok = file && fwrite(&h, sizeof(h), 1, file) == 1 && fwrite(binary, 1, h.size, file) == h.size;
+    if (file)
+        ok = (fclose(file) == 0) && ok;
+    free(binary);
+    if (!ok || rename(tmpPath, cachePath) != 0) {
+        printf("Failed to write program cache: %s\n", cachePath);
+        remove(tmpPath);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef PROGCACHE_H
+#define PROGCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <glad/glad.h>
+
+#define PROGCACHE_MAGIC "G3DP"
+#define PROGCACHE_VERSION 1
+#define PROGCACHE_EXT ".g3dp"
+
+typedef struct { // Заголовок кеша слинкованной программы (.g3dp), за ним size байт из glGetProgramBinary
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t size;
+} ProgCacheHeader;
+
+// Указатели на функции ARB_get_program_binary и KHR/ARB_parallel_shader_compile (в glad только ядро 3.3).
+// binary/parallel - есть ли расширения у контекста
+void programCacheInit(GLADloadproc load, int binary, int parallel);
+int programCacheEnabled(void);
+// Включает компиляцию на потоках драйвера: тогда glCompileShader/glLinkProgram не ждут результата
+int parallelShaderCompile(void);
+
+// Ключ: исходники обоих шейдеров и GL_VENDOR/GL_RENDERER/GL_VERSION (бинарник годится только для того же драйвера)
+uint64_t programCacheKey(const void* vertex, size_t vertexSize, const void* fragment, size_t fragmentSize);
+// 1 - программа слинкована из кеша; 0 - кеша нет, он от другой версии или драйвер его отверг
+int loadProgramBinary(const char* cachePath, uint64_t key, unsigned int program);
+// Перед glLinkProgram, чтобы драйвер сохранил бинарник
+void programBinaryHint(unsigned int program);
+void saveProgramBinary(const char* cachePath, uint64_t key, unsigned int program);
+
+#endif
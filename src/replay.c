@@ -0,0 +1,165 @@
+#include "replay.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define REPLAY_MAX_RUN_BYTES 6 // 4 + 7 * 4 бит хватает на uint32 длину
+
+_Static_assert(sizeof(ReplayHeader) == 32, "ReplayHeader layout is part of the .g3dr format");
+
+static unsigned packInput(const SimInput* input)
+{
+    return (input->left ? 1u : 0u) | (input->right ? 2u : 0u) | (input->fire ? 4u : 0u);
+}
+
+static int flushRun(Replay* replay)
+{
+    if (!replay->runLength)
+        return 0;
+    if (replay->size + REPLAY_MAX_RUN_BYTES > replay->capacity) {
+        size_t capacity = replay->capacity ? replay->capacity * 2 : 4096;
+        unsigned char* data = realloc(replay->data, capacity);
+        if (!data)
+            return -1;
+        replay->data = data;
+        replay->capacity = capacity;
+    }
+    uint32_t n = replay->runLength - 1;
+    unsigned char* out = replay->data + replay->size;
+    *out++ = (unsigned char)(replay->runInput | (n > 15 ? 8 : 0) | ((n & 15) << 4));
+    for (n >>= 4; n; n >>= 7)
+        *out++ = (unsigned char)((n & 127) | (n > 127 ? 128 : 0));
+    replay->size = out - replay->data;
+    replay->runLength = 0;
+    return 0;
+}
+
+// Разбор серии с offset; 0 - серия битая или data кончилась
+static size_t readRun(const unsigned char* data, size_t size, size_t offset, unsigned* input, uint32_t* length)
+{
+    if (offset >= size)
+        return 0;
+    size_t start = offset;
+    unsigned char b = data[offset++];
+    uint64_t n = b >> 4;
+    int more = b & 8;
+    for (int shift = 4; more; shift += 7) {
+        if (offset >= size || shift > 32)
+            return 0;
+        unsigned char c = data[offset++];
+        n |= (uint64_t)(c & 127) << shift;
+        more = c & 128;
+    }
+    if (n >= UINT32_MAX)
+        return 0;
+    *input = b & 7;
+    *length = (uint32_t)n + 1;
+    return offset - start;
+}
+
+void replayRecordStart(Replay* replay, uint64_t seed)
+{
+    memset(replay, 0, sizeof(*replay));
+    replay->seed = seed;
+}
+
+int replayRecord(Replay* replay, const SimInput* input)
+{
+    unsigned packed = packInput(input);
+    if (replay->runLength && (packed != replay->runInput || replay->runLength == UINT32_MAX) && flushRun(replay) != 0)
+        return -1;
+    replay->runInput = packed;
+    replay->runLength++;
+    replay->ticks++;
+    return 0;
+}
+
+int replaySave(Replay* replay, const char* path)
+{
+    if (flushRun(replay) != 0) {
+        printf("Failed to write replay: %s\n", path);
+        return -1;
+    }
+    ReplayHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, REPLAY_MAGIC, 4);
+    h.version = REPLAY_VERSION;
+    h.seed = replay->seed;
+    h.tickRate = SIM_TICK_RATE;
+    h.ticks = replay->ticks;
+    h.size = replay->size;
+
+    char tmpPath[520];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+    FILE* file = fopen(tmpPath, "wb");
+    if (!file) {
+        printf("Failed to write replay: %s\n", path);
+        return -1;
+    }
+    int ok = fwrite(&h, sizeof(h), 1, file) == 1 && (!replay->size || fwrite(replay->data, replay->size, 1, file) == 1);
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(tmpPath, path) != 0) {
+        printf("Failed to write replay: %s\n", path);
+        remove(tmpPath);
+        return -1;
+    }
+    return 0;
+}
+
+int replayLoad(const char* path, Replay* replay)
+{
+    memset(replay, 0, sizeof(*replay));
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        printf("Failed to open replay: %s\n", path);
+        return -1;
+    }
+    ReplayHeader h;
+    int ok = fread(&h, sizeof(h), 1, file) == 1 && memcmp(h.magic, REPLAY_MAGIC, 4) == 0 &&
+             h.version == REPLAY_VERSION && h.tickRate == SIM_TICK_RATE && h.size <= (uint64_t)h.ticks * REPLAY_MAX_RUN_BYTES;
+    unsigned char* data = ok && h.size ? malloc(h.size) : NULL;
+    ok = ok && (!h.size || (data && fread(data, h.size, 1, file) == 1));
+    fclose(file);
+
+    uint64_t ticks = 0; // Серии должны покрыть ровно h.ticks тиков
+    for (size_t offset = 0; ok && offset < h.size;) {
+        unsigned input;
+        uint32_t length;
+        size_t used = readRun(data, h.size, offset, &input, &length);
+        ok = used != 0;
+        offset += used;
+        ticks += length;
+    }
+    if (!ok || ticks != h.ticks) {
+        printf("Failed to load replay: %s\n", path);
+        free(data);
+        return -1;
+    }
+    replay->seed = h.seed;
+    replay->ticks = h.ticks;
+    replay->data = data;
+    replay->size = replay->capacity = h.size;
+    return 0;
+}
+
+int replayNext(Replay* replay, SimInput* input)
+{
+    if (!replay->runLength) {
+        size_t used = readRun(replay->data, replay->size, replay->offset, &replay->runInput, &replay->runLength);
+        if (!used)
+            return 0;
+        replay->offset += used;
+    }
+    replay->runLength--;
+    input->left = (replay->runInput & 1) != 0;
+    input->right = (replay->runInput & 2) != 0;
+    input->fire = (replay->runInput & 4) != 0;
+    return 1;
+}
+
+void replayFree(Replay* replay)
+{
+    free(replay->data);
+    memset(replay, 0, sizeof(*replay));
+}
@@ -0,0 +1,46 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sim.h"
+
+#define REPLAY_MAGIC "G3DR"
+#define REPLAY_VERSION 2 // Меняется вместе с поведением симуляции: старая запись с новой игрой не совпадет
+#define REPLAY_EXT ".g3dr"
+
+typedef struct { // Заголовок .g3dr, за ним size байт серий одинакового ввода
+    char magic[4];
+    uint32_t version;
+    uint64_t seed; // simInit
+    uint32_t tickRate; // SIM_TICK_RATE записи: при другом повтор не совпадет
+    uint32_t ticks;
+    uint64_t size;
+} ReplayHeader;
+
+// Серия: первый байт - биты 0..2 ввод (left, right, fire), бит 3 - продолжение длины, биты 4..7 - младшие биты
+// (длина - 1); дальше длина по 7 бит (LEB128). Серия до 16 тиков - 1 байт, час игры с живым вводом - единицы КБ
+typedef struct {
+    uint64_t seed;
+    uint32_t ticks;
+    unsigned char* data; // Закодированные серии
+    size_t size, capacity;
+    unsigned runInput; // Запись - незакрытая серия, воспроизведение - остаток текущей
+    uint32_t runLength;
+    size_t offset; // Воспроизведение: следующая серия в data
+} Replay;
+
+// Начало записи игры, запущенной simInit(seed)
+void replayRecordStart(Replay* replay, uint64_t seed);
+// Ввод одного тика. 0 при успехе
+int replayRecord(Replay* replay, const SimInput* input);
+// Запись в файл (через временный и rename). 0 при успехе
+int replaySave(Replay* replay, const char* path);
+// Чтение и проверка файла; воспроизведение с первого тика. 0 при успехе
+int replayLoad(const char* path, Replay* replay);
+// Ввод следующего тика: 1 - есть, 0 - запись закончилась
+int replayNext(Replay* replay, SimInput* input);
+void replayFree(Replay* replay);
+
+#endif
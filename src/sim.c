@@ -0,0 +1,660 @@
+#include "sim.h"
+
+// Без слияния a * b + c в FMA (-march с FMA): иначе результат зависит от флагов сборки, и повторы и seed
+// расходятся между сборками, а SIMD-путь - со скалярным
+#ifdef __clang__
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if ENEMY_SIMD || COLLIDE_SIMD
+#include <xmmintrin.h>
+#endif
+
+_Static_assert(FORMATION_ROWS * FORMATION_COLS <= MAX_ENEMIES, "Formation does not fit in MAX_ENEMIES");
+
+unsigned last_timebul = 0, last_enemy_shot = 0, lastDiveTime = 0;
+int playerHits = 0, kills = 0, playerIsHit = 0;
+int gameOver = 0;
+unsigned simTicks = 0;
+uint64_t simSeed = 0;
+SimRng simRng;
+float playerX = 0.0f, playerPrevX = 0.0f;
+BulletPool bullets;
+EnemyPool enemies;
+CollisionGrid collisionGrid;
+// Рабочие массивы проверки столкновений: без кучи в тике
+static CollisionHit hitList[MAX_BULLETS > MAX_ENEMIES ? MAX_BULLETS : MAX_ENEMIES];
+static _Alignas(16) float batchX[MAX_BULLETS], batchY[MAX_BULLETS]; // Пули игрока по клеткам сетки
+static int batchBullet[MAX_BULLETS];
+static _Alignas(16) float boxX[MAX_ENEMIES], boxY[MAX_ENEMIES];
+static int boxEnemy[MAX_ENEMIES];
+
+void simInit(uint64_t seed)
+{
+    bullets.count = 0;
+    bullets.dropped = 0;
+    last_timebul = last_enemy_shot = lastDiveTime = 0;
+    playerHits = kills = playerIsHit = gameOver = 0;
+    simTicks = 0;
+    simSeed = seed;
+    simRngSeed(&simRng, seed);
+    playerX = playerPrevX = 0.0f;
+    memset(&enemies, 0, sizeof(enemies));
+    spawnFormation();
+}
+
+void simRngSeed(SimRng* rng, uint64_t seed)
+{
+    rng->state = 0;
+    rng->inc = (seed << 1) | 1;
+    simRngNext(rng);
+    rng->state += seed;
+    simRngNext(rng);
+}
+
+uint32_t simRngNext(SimRng* rng)
+{
+    uint64_t old = rng->state;
+    rng->state = old * 6364136223846793005ull + rng->inc;
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+uint32_t simRngRange(SimRng* rng, uint32_t n)
+{
+    return (uint32_t)(((uint64_t)simRngNext(rng) * n) >> 32);
+}
+
+static uint64_t hashState(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* p = data;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ p[i]) * 1099511628211ull; // FNV-1a
+    return hash;
+}
+
+uint64_t simStateHash()
+{
+    uint64_t hash = 14695981039346656037ull;
+    int counters[] = {playerHits, kills, gameOver}; // Флаги попаданий - события тика, не состояние
+    unsigned clocks[] = {simTicks, last_timebul, last_enemy_shot, lastDiveTime};
+    hash = hashState(hash, counters, sizeof(counters));
+    hash = hashState(hash, clocks, sizeof(clocks));
+    hash = hashState(hash, &simRng, sizeof(simRng));
+    hash = hashState(hash, &playerX, sizeof(playerX));
+    hash = hashState(hash, enemies.x, MAX_ENEMIES * sizeof(float));
+    hash = hashState(hash, enemies.y, MAX_ENEMIES * sizeof(float));
+    hash = hashState(hash, enemies.speedX, MAX_ENEMIES * sizeof(float));
+    hash = hashState(hash, enemies.speedY, MAX_ENEMIES * sizeof(float));
+    hash = hashState(hash, enemies.lives, sizeof(enemies.lives));
+    hash = hashState(hash, enemies.active, sizeof(enemies.active));
+    hash = hashState(hash, enemies.diving, sizeof(enemies.diving));
+    hash = hashState(hash, &bullets.count, sizeof(bullets.count));
+    hash = hashState(hash, bullets.x, bullets.count * sizeof(float));
+    hash = hashState(hash, bullets.y, bullets.count * sizeof(float));
+    hash = hashState(hash, bullets.dir, bullets.count);
+    return hash;
+}
+
+int spawnBullet(float x, float y, int dir)
+{
+    if (bullets.count == MAX_BULLETS) {
+        bullets.dropped++;
+        return -1;
+    }
+    int i = bullets.count++;
+    bullets.x[i] = x;
+    bullets.y[i] = y;
+    bullets.prevY[i] = y;
+    bullets.dir[i] = (signed char)dir;
+    return 0;
+}
+
+void removeBullet(int i)
+{
+    int last = --bullets.count;
+    bullets.x[i] = bullets.x[last];
+    bullets.y[i] = bullets.y[last];
+    bullets.prevY[i] = bullets.prevY[last];
+    bullets.dir[i] = bullets.dir[last];
+}
+
+void shootBullet(float px)
+{
+    if (simTicks - last_timebul > SIM_TICKS(0.65) && spawnBullet(px, STARTPLY + ENEMY_SIZEY, 1) == 0)
+        last_timebul = simTicks;
+}
+
+void updateBullets()
+{
+    for (int i = 0; i < bullets.count; i++)
+        bullets.y[i] += BULLETSPEED * SIM_DT * bullets.dir[i];
+    for (int i = 0; i < bullets.count;)
+        if (fabsf(bullets.y[i]) > 1.0f)
+            removeBullet(i);
+        else
+            i++;
+}
+
+void shootEnemyBullet(float ex, float ey, unsigned interval)
+{
+    if (simTicks - last_enemy_shot > interval && spawnBullet(ex, ey, -1) == 0)
+        last_enemy_shot = simTicks;
+}
+
+int collidePointsScalar(const float* x, const float* y, const signed char* team, int side, int count, const float* boxX,
+                        const float* boxY, int boxes, float rx, float ry, CollisionHit* hits)
+{
+    int numHits = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (team && team[i] != side)
+            continue;
+        for (int j = 0; j < boxes; j++)
+        {
+            if (fabsf(x[i] - boxX[j]) <= rx && fabsf(y[i] - boxY[j]) <= ry)
+            {
+                hits[numHits].point = i;
+                hits[numHits].box = j;
+                numHits++;
+                break;
+            }
+        }
+    }
+    return numHits;
+}
+
+#if COLLIDE_SIMD
+// Проверка четверки точек idx[0..n) по коробкам до первого попадания каждой; попадания - в hits по возрастанию дорожки
+static int collideGroup(const float* x, const float* y, const int* idx, int n, const float* boxX, const float* boxY, int boxes,
+                        __m128 rx, __m128 ry, CollisionHit* hits)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    int last = idx[n - 1]; // Пустые дорожки повторяют последнюю точку, их результат не берется
+    __m128 px = _mm_setr_ps(x[idx[0]], x[n > 1 ? idx[1] : last], x[n > 2 ? idx[2] : last], x[last]);
+    __m128 py = _mm_setr_ps(y[idx[0]], y[n > 1 ? idx[1] : last], y[n > 2 ? idx[2] : last], y[last]);
+    unsigned want = (1u << n) - 1, pending = want; // Еще без коробки
+    int box[4];
+    for (int j = 0; j < boxes && pending; j++) {
+        __m128 dx = _mm_andnot_ps(sign, _mm_sub_ps(px, _mm_set1_ps(boxX[j]))); // fabsf - сброс знакового бита
+        __m128 dy = _mm_andnot_ps(sign, _mm_sub_ps(py, _mm_set1_ps(boxY[j])));
+        unsigned hit = (unsigned)_mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(dx, rx), _mm_cmple_ps(dy, ry))) & pending;
+        if (hit) {
+            for (unsigned m = hit; m; m &= m - 1)
+                box[__builtin_ctz(m)] = j;
+            pending &= ~hit;
+        }
+    }
+    int numHits = 0;
+    for (unsigned m = want & ~pending; m; m &= m - 1) {
+        hits[numHits].point = idx[__builtin_ctz(m)];
+        hits[numHits].box = box[__builtin_ctz(m)];
+        numHits++;
+    }
+    return numHits;
+}
+
+int collidePointsSimd(const float* x, const float* y, const signed char* team, int side, int count, const float* boxX,
+                      const float* boxY, int boxes, float rx, float ry, CollisionHit* hits)
+{
+    const __m128 rx4 = _mm_set1_ps(rx), ry4 = _mm_set1_ps(ry);
+    int numHits = 0, idx[4], n = 0;
+    for (int i = 0; i < count; i++) { // Точки нужной стороны собираются по 4, чужие не занимают дорожки
+        if (team && team[i] != side)
+            continue;
+        idx[n++] = i;
+        if (n == 4) {
+            numHits += collideGroup(x, y, idx, 4, boxX, boxY, boxes, rx4, ry4, hits + numHits);
+            n = 0;
+        }
+    }
+    if (n)
+        numHits += collideGroup(x, y, idx, n, boxX, boxY, boxes, rx4, ry4, hits + numHits);
+    return numHits;
+}
+#else
+int collidePointsSimd(const float* x, const float* y, const signed char* team, int side, int count, const float* boxX,
+                      const float* boxY, int boxes, float rx, float ry, CollisionHit* hits)
+{
+    return collidePointsScalar(x, y, team, side, count, boxX, boxY, boxes, rx, ry, hits);
+}
+#endif
+
+static int compareHits(const void* a, const void* b)
+{
+    return ((const CollisionHit*)a)->point - ((const CollisionHit*)b)->point;
+}
+
+int gridCellX(float x)
+{
+    float c = (x + 1.0f) * (1.0f / GRID_CELL); // Отсечение до преобразования: для c >= 0 оно же floor, NaN - в 0
+    return !(c >= 0.0f) ? 0 : c >= GRID_COLS ? GRID_COLS - 1 : (int)c;
+}
+
+int gridCellY(float y)
+{
+    float c = (y + 1.0f) * (1.0f / GRID_CELL);
+    return !(c >= 0.0f) ? 0 : c >= GRID_ROWS ? GRID_ROWS - 1 : (int)c;
+}
+
+void buildCollisionGrid(CollisionGrid* grid, const EnemyPool* e)
+{
+    // Подсчет по клеткам, префиксные суммы, раскладка; враги идут по возрастанию индекса
+    unsigned char x0[MAX_ENEMIES], x1[MAX_ENEMIES], y0[MAX_ENEMIES], y1[MAX_ENEMIES];
+    memset(grid->start, 0, sizeof(grid->start));
+    for (int j = 0; j < MAX_ENEMIES; j++)
+    {
+        if (!ENEMY_BIT(e->active, j))
+            continue;
+        x0[j] = (unsigned char)gridCellX(e->x[j] - ENEMY_SIZEX);
+        x1[j] = (unsigned char)gridCellX(e->x[j] + ENEMY_SIZEX);
+        y0[j] = (unsigned char)gridCellY(e->y[j] - ENEMY_SIZEY);
+        y1[j] = (unsigned char)gridCellY(e->y[j] + ENEMY_SIZEY);
+        for (int cy = y0[j]; cy <= y1[j]; cy++)
+            for (int cx = x0[j]; cx <= x1[j]; cx++)
+                grid->start[cy * GRID_COLS + cx + 1]++;
+    }
+    for (int c = 0; c < GRID_COLS * GRID_ROWS; c++)
+        grid->start[c + 1] += grid->start[c];
+    int fill[GRID_COLS * GRID_ROWS];
+    memcpy(fill, grid->start, sizeof(fill));
+    for (int j = 0; j < MAX_ENEMIES; j++)
+        if (ENEMY_BIT(e->active, j))
+            for (int cy = y0[j]; cy <= y1[j]; cy++)
+                for (int cx = x0[j]; cx <= x1[j]; cx++)
+                    grid->items[fill[cy * GRID_COLS + cx]++] = j;
+}
+
+static int collidePoints(const float* x, const float* y, const signed char* team, int side, int count, const float* boxX,
+                         const float* boxY, int boxes, float rx, float ry, CollisionHit* hits)
+{
+    if (COLLIDE_SIMD)
+        return collidePointsSimd(x, y, team, side, count, boxX, boxY, boxes, rx, ry, hits);
+    return collidePointsScalar(x, y, team, side, count, boxX, boxY, boxes, rx, ry, hits);
+}
+
+// Попадания пуль игрока во врагов, по возрастанию пули. Пуля достается живому в начале тика врагу с меньшим
+// индексом. Много пуль - пули раскладываются по клеткам сетки и каждая клетка проверяется пачкой против своих
+// врагов, мало - все пули против всех врагов
+static int findEnemyHits(CollisionHit* hits)
+{
+    if (bullets.count < GRID_MIN_BULLETS) {
+        int boxes = 0;
+        for (int j = 0; j < MAX_ENEMIES; j++)
+            if (ENEMY_BIT(enemies.active, j)) {
+                boxX[boxes] = enemies.x[j];
+                boxY[boxes] = enemies.y[j];
+                boxEnemy[boxes++] = j;
+            }
+        int numHits = collidePoints(bullets.x, bullets.y, bullets.dir, 1, bullets.count, boxX, boxY, boxes, ENEMY_SIZEX,
+                                    ENEMY_SIZEY, hits);
+        for (int k = 0; k < numHits; k++)
+            hits[k].box = boxEnemy[hits[k].box];
+        return numHits;
+    }
+
+    buildCollisionGrid(&collisionGrid, &enemies);
+    int cellStart[GRID_COLS * GRID_ROWS + 1] = {0}; // Пули игрока по клеткам: batch*[cellStart[c]..cellStart[c + 1])
+    for (int i = 0; i < bullets.count; i++)
+        if (bullets.dir[i] == 1)
+            cellStart[gridCellY(bullets.y[i]) * GRID_COLS + gridCellX(bullets.x[i]) + 1]++;
+    for (int c = 0; c < GRID_COLS * GRID_ROWS; c++)
+        cellStart[c + 1] += cellStart[c];
+    int fill[GRID_COLS * GRID_ROWS];
+    memcpy(fill, cellStart, sizeof(fill));
+    for (int i = 0; i < bullets.count; i++)
+        if (bullets.dir[i] == 1) {
+            int k = fill[gridCellY(bullets.y[i]) * GRID_COLS + gridCellX(bullets.x[i])]++;
+            batchX[k] = bullets.x[i];
+            batchY[k] = bullets.y[i];
+            batchBullet[k] = i;
+        }
+
+    int numHits = 0;
+    for (int c = 0; c < GRID_COLS * GRID_ROWS; c++) {
+        int first = collisionGrid.start[c], boxes = collisionGrid.start[c + 1] - first;
+        int start = cellStart[c], count = cellStart[c + 1] - start;
+        if (!boxes || !count)
+            continue;
+        for (int k = 0; k < boxes; k++) {
+            boxX[k] = enemies.x[collisionGrid.items[first + k]];
+            boxY[k] = enemies.y[collisionGrid.items[first + k]];
+        }
+        int cellHits = collidePoints(batchX + start, batchY + start, NULL, 0, count, boxX, boxY, boxes, ENEMY_SIZEX,
+                                     ENEMY_SIZEY, hits + numHits);
+        for (int k = numHits; k < numHits + cellHits; k++) {
+            hits[k].point = batchBullet[start + hits[k].point];
+            hits[k].box = collisionGrid.items[first + hits[k].box];
+        }
+        numHits += cellHits;
+    }
+    qsort(hits, numHits, sizeof(CollisionHit), compareHits); // Пуля - не больше одного попадания, порядок однозначен
+    return numHits;
+}
+
+// Пули игрока против врагов: сначала список попаданий, потом их применение. Враг, живой в начале тика, принимает
+// все попавшие в него пули этого тика
+void updateEnemy()
+{
+    if (!bullets.count)
+        return;
+    int numHits = findEnemyHits(hitList);
+    for (int k = numHits - 1; k >= 0; k--) // С конца: удаление переносит последнюю пулю, а она уже обработана
+    {
+        int j = hitList[k].box;
+        enemies.lives[j]--;
+        removeBullet(hitList[k].point);
+        enemies.hit[j] = 1;
+        if (enemies.lives[j] == 0)
+        {
+            ENEMY_CLEAR(enemies.active, j);
+            ENEMY_CLEAR(enemies.diving, j);
+            kills++;
+        }
+    }
+}
+
+void spawnFormation()
+{
+    for (int r = 0; r < FORMATION_ROWS; r++)
+        for (int c = 0; c < FORMATION_COLS; c++)
+        {
+            int i = r * FORMATION_COLS + c;
+            enemies.x[i] = -H_SPACING * (FORMATION_COLS - 1) / 2 + c * H_SPACING;
+            enemies.y[i] = 0.8f - r * V_SPACING;
+            enemies.prevX[i] = enemies.x[i];
+            enemies.prevY[i] = enemies.y[i];
+            enemies.speedX[i] = ENEMY_SPEED;
+            enemies.speedY[i] = 0.0f;
+            enemies.lives[i] = 2;
+            enemies.hit[i] = 0;
+            ENEMY_SET(enemies.active, i);
+            ENEMY_CLEAR(enemies.diving, i);
+        }
+}
+
+// Строй: живые и не пикирующие
+static uint64_t formationWord(const EnemyPool* e, int word)
+{
+    return e->active[word] & ~e->diving[word];
+}
+
+void moveEnemiesScalar(EnemyPool* e, float playerX, uint64_t* exited)
+{
+    memset(exited, 0, ENEMY_MASK_WORDS * sizeof(uint64_t));
+    int bounce = 0;
+    for (int i = 0; i < MAX_ENEMIES && !bounce; i++)
+        if ((formationWord(e, i >> 6) >> (i & 63) & 1) &&
+            (e->x[i] + ENEMY_SIZEX >= SCREEN_LIMIT_X || e->x[i] - ENEMY_SIZEX <= -SCREEN_LIMIT_X))
+            bounce = 1;
+
+    for (int i = 0; i < MAX_ENEMIES; i++)
+    {
+        if (!ENEMY_BIT(e->active, i))
+            continue;
+
+        if (ENEMY_BIT(e->diving, i))
+        {
+            float dx = playerX - e->x[i];
+            float dy = STARTPLY - e->y[i];
+            float dist = sqrtf(dx * dx + dy * dy);
+            if (dist > 0.0f)
+            {
+                dx /= dist;
+                dy /= dist;
+                e->speedX[i] += DIVE_ACCEL * SIM_DT * dx;
+                e->speedY[i] += DIVE_ACCEL * SIM_DT * dy;
+            }
+            e->x[i] += e->speedX[i] * SIM_DT;
+            e->y[i] += e->speedY[i] * SIM_DT;
+            if (e->y[i] < STARTPLY - 0.5f || e->x[i] < -1.0f || e->x[i] > 1.0f)
+                ENEMY_SET(exited, i);
+        }
+        else
+        {
+            if (bounce)
+                e->speedX[i] = -e->speedX[i];
+            e->x[i] += e->speedX[i] * SIM_DT;
+        }
+    }
+}
+
+#if ENEMY_SIMD
+// Маски дорожек SSE по 4 битам маски врагов
+#define LANE(m, b) ((m) >> (b) & 1 ? 0xffffffffu : 0)
+#define LANES(m) {{LANE(m, 0), LANE(m, 1), LANE(m, 2), LANE(m, 3)}}
+static const union {
+    uint32_t u[4];
+    __m128 v;
+} laneMasks[16] = {LANES(0), LANES(1), LANES(2),  LANES(3),  LANES(4),  LANES(5),  LANES(6),  LANES(7),
+                   LANES(8), LANES(9), LANES(10), LANES(11), LANES(12), LANES(13), LANES(14), LANES(15)};
+
+// Биты врагов i..i+3 (i кратно 4)
+static unsigned laneBits(uint64_t word, int i)
+{
+    return (unsigned)(word >> (i & 63)) & 15;
+}
+
+static __m128 blend(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+void moveEnemiesSimd(EnemyPool* e, float playerX, uint64_t* exited)
+{
+    memset(exited, 0, ENEMY_MASK_WORDS * sizeof(uint64_t));
+    const __m128 dt = _mm_set1_ps(SIM_DT);
+    const __m128 size = _mm_set1_ps(ENEMY_SIZEX), limit = _mm_set1_ps(SCREEN_LIMIT_X), negLimit = _mm_set1_ps(-SCREEN_LIMIT_X);
+    int bounce = 0;
+    for (int i = 0; i < ENEMY_LANES && !bounce; i += 4) {
+        unsigned f = laneBits(formationWord(e, i >> 6), i);
+        if (!f)
+            continue;
+        __m128 x = _mm_load_ps(e->x + i);
+        __m128 edge = _mm_or_ps(_mm_cmpge_ps(_mm_add_ps(x, size), limit), _mm_cmple_ps(_mm_sub_ps(x, size), negLimit));
+        bounce = (_mm_movemask_ps(edge) & f) != 0;
+    }
+    const __m128 flip = bounce ? _mm_set1_ps(-0.0f) : _mm_setzero_ps(); // Смена знака xor знакового бита - как -speedX
+
+    const __m128 px = _mm_set1_ps(playerX), py = _mm_set1_ps(STARTPLY);
+    const __m128 accel = _mm_set1_ps(DIVE_ACCEL * SIM_DT), zero = _mm_setzero_ps();
+    const __m128 bottom = _mm_set1_ps(STARTPLY - 0.5f), left = _mm_set1_ps(-1.0f), right = _mm_set1_ps(1.0f);
+    for (int i = 0; i < ENEMY_LANES; i += 4) {
+        unsigned f = laneBits(formationWord(e, i >> 6), i);
+        unsigned d = laneBits(e->active[i >> 6] & e->diving[i >> 6], i);
+        if (!(f | d))
+            continue;
+        __m128 x = _mm_load_ps(e->x + i);
+        __m128 sx = _mm_load_ps(e->speedX + i);
+        __m128 fm = laneMasks[f].v, dm = laneMasks[d].v;
+        if (!d) { // Только строй - частый случай, без корня и деления
+            sx = _mm_xor_ps(sx, _mm_and_ps(fm, flip));
+            _mm_store_ps(e->x + i, blend(fm, _mm_add_ps(x, _mm_mul_ps(sx, dt)), x));
+            _mm_store_ps(e->speedX + i, sx);
+            continue;
+        }
+        __m128 y = _mm_load_ps(e->y + i), sy = _mm_load_ps(e->speedY + i);
+
+        // Пикирующие: ускорение к игроку
+        __m128 dx = _mm_sub_ps(px, x), dy = _mm_sub_ps(py, y);
+        __m128 dist = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        __m128 steer = _mm_and_ps(dm, _mm_cmpgt_ps(dist, zero));
+        sx = blend(steer, _mm_add_ps(sx, _mm_mul_ps(accel, _mm_div_ps(dx, dist))), sx);
+        sy = blend(steer, _mm_add_ps(sy, _mm_mul_ps(accel, _mm_div_ps(dy, dist))), sy);
+        // Строй: разворот
+        sx = _mm_xor_ps(sx, _mm_and_ps(fm, flip));
+
+        __m128 moving = _mm_or_ps(fm, dm);
+        __m128 nx = blend(moving, _mm_add_ps(x, _mm_mul_ps(sx, dt)), x);
+        __m128 ny = blend(dm, _mm_add_ps(y, _mm_mul_ps(sy, dt)), y);
+        _mm_store_ps(e->x + i, nx);
+        _mm_store_ps(e->y + i, ny);
+        _mm_store_ps(e->speedX + i, sx);
+        _mm_store_ps(e->speedY + i, sy);
+
+        __m128 out = _mm_or_ps(_mm_cmplt_ps(ny, bottom), _mm_or_ps(_mm_cmplt_ps(nx, left), _mm_cmpgt_ps(nx, right)));
+        exited[i >> 6] |= (uint64_t)(_mm_movemask_ps(out) & d) << (i & 63);
+    }
+}
+#else
+void moveEnemiesSimd(EnemyPool* e, float playerX, uint64_t* exited)
+{
+    moveEnemiesScalar(e, playerX, exited);
+}
+#endif
+
+void updateEnemyMovement(float playerX)
+{
+    uint64_t exited[ENEMY_MASK_WORDS];
+    if (ENEMY_SIMD)
+        moveEnemiesSimd(&enemies, playerX, exited);
+    else
+        moveEnemiesScalar(&enemies, playerX, exited);
+
+    for (int i = 0; i < MAX_ENEMIES; i++) // Улетевшие возвращаются в строй на свое место относительно текущего строя
+    {
+        if (!ENEMY_BIT(exited, i))
+            continue;
+        float deltaX = 0.0f;
+        float repInitX = 0.0f;
+        float repSpeed = ENEMY_SPEED;
+        for (int k = 0; k < MAX_ENEMIES; k++)
+        {
+            if (formationWord(&enemies, k >> 6) >> (k & 63) & 1)
+            {
+                int c = k % FORMATION_COLS;
+                repInitX = -H_SPACING * (FORMATION_COLS - 1) / 2 + c * H_SPACING;
+                deltaX = enemies.x[k] - repInitX;
+                repSpeed = enemies.speedX[k];
+                break;
+            }
+        }
+
+        int r = i / FORMATION_COLS, c = i % FORMATION_COLS;
+        float initX = -H_SPACING * (FORMATION_COLS - 1) / 2 + c * H_SPACING;
+        enemies.x[i] = initX + deltaX;
+        enemies.y[i] = 0.8f - r * V_SPACING;
+        enemies.prevX[i] = enemies.x[i]; // Возврат в строй - скачок, без интерполяции
+        enemies.prevY[i] = enemies.y[i];
+        enemies.speedX[i] = repSpeed;
+        enemies.speedY[i] = 0.0f;
+        ENEMY_CLEAR(enemies.diving, i);
+    }
+}
+
+void diveAttack(float px)
+{
+    if (simTicks - lastDiveTime < SIM_TICKS(DIVE_INTERVAL))
+        return;
+    int start = (FORMATION_ROWS - 1) * FORMATION_COLS, end = start + FORMATION_COLS;
+    int cand[FORMATION_COLS], cnt = 0;
+    for (int i = start; i < end; i++)
+        if (ENEMY_BIT(enemies.active, i) && !ENEMY_BIT(enemies.diving, i))
+            cand[cnt++] = i;
+    if (!cnt)
+        return;
+    int pick = cand[simRngRange(&simRng, cnt)];
+    float dx = px - enemies.x[pick], dy = STARTPLY - enemies.y[pick];
+    float len = sqrtf(dx * dx + dy * dy);
+    enemies.speedX[pick] = DIVE_SPEED * dx / len;
+    enemies.speedY[pick] = DIVE_SPEED * dy / len;
+    ENEMY_SET(enemies.diving, pick);
+    lastDiveTime = simTicks;
+}
+
+void checkDiveCollisions(float playerX)
+{
+    int divers = 0;
+    for (int i = 0; i < MAX_ENEMIES; i++)
+        if (ENEMY_BIT(enemies.diving, i))
+        {
+            boxX[divers] = enemies.x[i];
+            boxY[divers] = enemies.y[i];
+            boxEnemy[divers++] = i;
+        }
+    float py = STARTPLY;
+    int numHits = collidePoints(boxX, boxY, NULL, 0, divers, &playerX, &py, 1, PLAYER_COLLIDE_RX + ENEMY_SIZEX,
+                                PLAYER_COLLIDE_RY + ENEMY_SIZEY, hitList);
+    for (int k = 0; k < numHits; k++)
+    {
+        int i = boxEnemy[hitList[k].point];
+        playerHits++;
+        playerIsHit = 1;
+        enemies.lives[i] = 0;
+        ENEMY_CLEAR(enemies.active, i);
+        ENEMY_CLEAR(enemies.diving, i);
+        kills++;
+        if (playerHits >= PLAYER_HITS_TO_DIE)
+            gameOver = 1;
+    }
+}
+
+void updatePlayerHits(float px)
+{
+    float py = STARTPLY;
+    int numHits = collidePoints(bullets.x, bullets.y, bullets.dir, -1, bullets.count, &px, &py, 1, PLAYER_COLLIDE_RX,
+                                PLAYER_COLLIDE_RY, hitList);
+    for (int k = numHits - 1; k >= 0; k--)
+    {
+        playerHits++;
+        playerIsHit = 1;
+        removeBullet(hitList[k].point);
+        if (playerHits >= PLAYER_HITS_TO_DIE)
+            gameOver = 1;
+    }
+}
+
+void simTick(const SimInput* in)
+{
+    if (gameOver)
+        return;
+    memset(enemies.hit, 0, sizeof(enemies.hit));
+    playerIsHit = 0;
+    memcpy(enemies.prevX, enemies.x, sizeof(enemies.x));
+    memcpy(enemies.prevY, enemies.y, sizeof(enemies.y));
+    memcpy(bullets.prevY, bullets.y, bullets.count * sizeof(float));
+    playerPrevX = playerX;
+    simTicks++;
+
+    if (in->left && playerX > -SCREEN_LIMIT_X)
+        playerX -= PLAYER_SPEED * SIM_DT;
+    if (in->right && playerX < SCREEN_LIMIT_X)
+        playerX += PLAYER_SPEED * SIM_DT;
+    if (in->fire)
+        shootBullet(playerX);
+
+    updateEnemy();
+    updateBullets();
+    for (int j = 0; j < MAX_ENEMIES; j++)
+        if (ENEMY_BIT(enemies.active, j) && simRngRange(&simRng, ENEMY_FIRE_ODDS * SIM_TICK_RATE / 60) == 0)
+            shootEnemyBullet(enemies.x[j], enemies.y[j], SIM_TICKS(2));
+    updateEnemyMovement(playerX);
+    diveAttack(playerX);
+    for (int i = 0; i < MAX_ENEMIES; i++)
+        if (ENEMY_BIT(enemies.diving, i))
+            shootEnemyBullet(enemies.x[i], enemies.y[i], SIM_TICKS(0.5));
+    checkDiveCollisions(playerX);
+    updatePlayerHits(playerX);
+}
+
+int simClockAdvance(SimClock* clock, double elapsed)
+{
+    clock->accumulator += elapsed < SIM_MAX_FRAME_TIME ? elapsed : SIM_MAX_FRAME_TIME;
+    int ticks = 0;
+    while (clock->accumulator >= SIM_DT) {
+        clock->accumulator -= SIM_DT;
+        ticks++;
+    }
+    return ticks;
+}
+
+float simClockAlpha(const SimClock* clock)
+{
+    return (float)(clock->accumulator / SIM_DT);
+}
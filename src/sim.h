@@ -0,0 +1,173 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+// Игровая логика без окна и GL: состояние, тик фиксированной длины и накопитель времени.
+// Часы и ввод задает вызывающий: игра - реальным временем и клавиатурой, headless - без ожидания
+
+#define BULLETTIME 0.70
+#define SIM_TICK_RATE 60 // Тиков симуляции в секунду, независимо от частоты кадров
+#define SIM_DT (1.0f / SIM_TICK_RATE)
+#define SIM_TICKS(seconds) ((unsigned)((seconds) * SIM_TICK_RATE + 0.5)) // Длительность в целых тиках
+#define SIM_MAX_FRAME_TIME 0.25 // Секунд, которые догоняются после зависания; остальное отбрасывается
+// Скорости в единицах экрана в секунду (ускорение - в секунду за секунду); подобраны под прежние 60 кадров/с
+#define BULLETSPEED 0.6f
+#define PLAYER_SPEED 0.6f
+#define ENEMY_FIRE_ODDS 500 // Каждый враг стреляет с вероятностью 1/N за тик при 60 тиках/с
+#ifndef MAX_BULLETS
+#define MAX_BULLETS 100 // Емкость пула пуль; выстрел в полный пул не происходит (bullets.dropped)
+#endif
+#ifndef MAX_ENEMIES
+#define MAX_ENEMIES 30
+#endif
+#define ENEMY_LANES ((MAX_ENEMIES + 3) & ~3)      // Длина массивов врагов: целые группы по 4 для SSE
+#define ENEMY_MASK_WORDS ((MAX_ENEMIES + 63) / 64) // Битовые маски врагов, бит i - враг i
+#ifndef ENEMY_SIMD
+#if defined(__SSE__) || defined(_M_X64)
+#define ENEMY_SIMD 1 // Движение врагов по 4 за раз (SSE); 0 - скалярный эталон
+#else
+#define ENEMY_SIMD 0
+#endif
+#endif
+#ifndef COLLIDE_SIMD
+#define COLLIDE_SIMD ENEMY_SIMD // Столкновения по 4 пули за раз (SSE); 0 - скалярный эталон
+#endif
+
+#define ENEMY_SIZEX 0.1f
+#define ENEMY_SIZEY 0.1f
+#define ENEMY_SIZEZ 0.05f
+#define ENEMY_SPEED 0.12f
+#define SCREEN_LIMIT_X 0.9f
+#define PLAYER_HITS_TO_DIE 10
+#ifndef FORMATION_ROWS
+#define FORMATION_ROWS 3
+#endif
+#ifndef FORMATION_COLS
+#define FORMATION_COLS 9
+#endif
+#define H_SPACING 0.15f
+#define V_SPACING 0.2f
+#define DIVE_INTERVAL 7
+#define DIVE_SPEED 0.12f
+#define DIVE_ACCEL 0.18f
+#define PLAYER_COLLIDE_RX 0.05f
+#define PLAYER_COLLIDE_RY 0.05f
+#define STARTPLY -0.4f
+// Сетка столкновений над полем [-1, 1] x [-1, 1]; клетка не меньше врага (ENEMY_SIZEY <= ENEMY_SIZEX), но из-за
+// округления края врага могут попасть в клетки через одну (x = -0.7 - клетки 0..2), так что враг занимает до 3x3
+// клеток. Все, что за полем, попадает в крайние клетки
+#define GRID_CELL (2 * ENEMY_SIZEX)
+#define GRID_COLS 10
+#define GRID_ROWS 10
+#define GRID_ENEMY_CELLS 9 // Клеток на врага в худшем случае
+#ifndef GRID_MIN_BULLETS
+#define GRID_MIN_BULLETS 8 // Меньше пуль - перебор всех врагов дешевле построения сетки
+#endif
+
+typedef struct // Пул пуль, массивы по полям: живые - [0, count), удаление переносит последнюю на место удаленной
+{
+    _Alignas(32) float x[MAX_BULLETS];
+    _Alignas(32) float y[MAX_BULLETS];
+    _Alignas(32) float prevY[MAX_BULLETS]; // y на прошлом тике, для интерполяции при отрисовке
+    _Alignas(32) signed char dir[MAX_BULLETS]; // 1 - пуля игрока (вверх), -1 - врага
+    int count;
+    unsigned dropped; // Выстрелов, не поместившихся в пул
+} BulletPool;
+typedef struct // Враги, массивы по полям: позиция и скорость, нужные каждый тик, отдельно от жизней и попаданий
+{
+    _Alignas(16) float x[ENEMY_LANES];
+    _Alignas(16) float y[ENEMY_LANES];
+    _Alignas(16) float speedX[ENEMY_LANES];
+    _Alignas(16) float speedY[ENEMY_LANES];
+    _Alignas(16) float prevX[ENEMY_LANES]; // Позиция на прошлом тике, для интерполяции при отрисовке
+    _Alignas(16) float prevY[ENEMY_LANES];
+    int lives[MAX_ENEMIES];
+    char hit[MAX_ENEMIES]; // Попадание за последний тик; сбрасывается в начале simTick
+    uint64_t active[ENEMY_MASK_WORDS];
+    uint64_t diving[ENEMY_MASK_WORDS]; // Только среди active
+} EnemyPool;
+#define ENEMY_BIT(mask, i) (((mask)[(i) >> 6] >> ((i) & 63)) & 1)
+#define ENEMY_SET(mask, i) ((mask)[(i) >> 6] |= 1ull << ((i) & 63))
+#define ENEMY_CLEAR(mask, i) ((mask)[(i) >> 6] &= ~(1ull << ((i) & 63)))
+typedef struct // Враги по клеткам сетки, перестраивается каждый тик; в клетке - индексы по возрастанию
+{
+    int start[GRID_COLS * GRID_ROWS + 1]; // Враги клетки c - items[start[c]..start[c + 1])
+    int items[MAX_ENEMIES * GRID_ENEMY_CELLS];
+} CollisionGrid;
+typedef struct // Попадание точки (пули) в коробку (врага, игрока)
+{
+    int point, box;
+} CollisionHit;
+typedef struct // Состояние управления, снятое за кадр и действующее на тики этого кадра
+{
+    char left, right, fire;
+} SimInput;
+typedef struct // PCG32: 64 бита состояния, период 2^64; одинаковый seed - одинаковая последовательность на любой платформе
+{
+    uint64_t state, inc;
+} SimRng;
+typedef struct // Накопитель прошедшего времени в целые тики
+{
+    double accumulator;
+} SimClock;
+
+extern BulletPool bullets;
+extern EnemyPool enemies;
+extern unsigned last_timebul, last_enemy_shot, lastDiveTime; // Тик последнего выстрела/пике
+extern int playerHits, kills;
+extern int playerIsHit; // Попадание в игрока за последний тик, как enemies.hit
+extern int gameOver; // Игрок сбит PLAYER_HITS_TO_DIE раз; тики больше ничего не меняют
+extern unsigned simTicks; // Часы симуляции: тиков с начала игры; все задержки считаются в тиках
+extern uint64_t simSeed; // Seed текущей игры: с тем же seed и тем же вводом игра повторяется бит в бит
+extern SimRng simRng;    // Единственный источник случайности симуляции
+extern float playerX, playerPrevX;
+
+// Новая игра: строй врагов, пуль нет, часы с нуля, генератор от seed
+void simInit(uint64_t seed);
+// Один шаг симуляции длиной SIM_DT: игрок, пули, враги, столкновения
+void simTick(const SimInput* in);
+// Хеш всего состояния игры, для сравнения прогонов
+uint64_t simStateHash();
+// elapsed секунд реального времени (не больше SIM_MAX_FRAME_TIME за раз) - сколько тиков выполнить
+int simClockAdvance(SimClock* clock, double elapsed);
+// Доля следующего тика для интерполяции между прошлым и текущим состоянием
+float simClockAlpha(const SimClock* clock);
+
+void simRngSeed(SimRng* rng, uint64_t seed);
+uint32_t simRngNext(SimRng* rng);
+// Равномерно в [0, n)
+uint32_t simRngRange(SimRng* rng, uint32_t n);
+
+// Новая пуля в конец пула. 0 при успехе, -1 - пул полон
+int spawnBullet(float x, float y, int dir);
+// O(1): на место i встает последняя пуля
+void removeBullet(int i);
+void shootBullet(float px);
+void updateBullets();
+void shootEnemyBullet(float ex, float ey, unsigned interval);
+// Точки (x, y) против коробок с центрами (boxX, boxY) и полуразмерами rx, ry: для каждой точки - первая коробка,
+// для которой |x - boxX| <= rx и |y - boxY| <= ry. team != NULL - проверяются только точки с team[i] == side.
+// В hits (не больше count) - по возрастанию точки; возвращает число попаданий. Simd дает тот же список, что Scalar
+int collidePointsScalar(const float* x, const float* y, const signed char* team, int side, int count, const float* boxX,
+                        const float* boxY, int boxes, float rx, float ry, CollisionHit* hits);
+int collidePointsSimd(const float* x, const float* y, const signed char* team, int side, int count, const float* boxX,
+                      const float* boxY, int boxes, float rx, float ry, CollisionHit* hits);
+// Номер клетки по координате, с зажимом в сетку
+int gridCellX(float x);
+int gridCellY(float y);
+// Раскладка живых врагов по клеткам
+void buildCollisionGrid(CollisionGrid* grid, const EnemyPool* e);
+void updateEnemy();
+void spawnFormation();
+// Движение строя (с разворотом у края) и пикирующих за тик; exited - пикирующие, улетевшие за экран.
+// Возврат в строй делает updateEnemyMovement. Scalar - эталон, Simd дает бит в бит тот же результат
+void moveEnemiesScalar(EnemyPool* e, float playerX, uint64_t* exited);
+void moveEnemiesSimd(EnemyPool* e, float playerX, uint64_t* exited);
+void updateEnemyMovement(float playerX);
+void diveAttack(float px);
+void checkDiveCollisions(float playerX);
+void updatePlayerHits(float px);
+extern CollisionGrid collisionGrid;
+
+#endif
@@ -0,0 +1,61 @@
+// Офлайн-сжатие текстур в .g3dt (BC1/BC3 с мипами): ./texcook [изображения...]
+// Результат - <каталог изображения>/cooked/<ключ>.g3dt, где ключ - хеш содержимого; неизменные не готовятся заново.
+// Без аргументов готовит текстуры игры. Сборка: gcc -O2 texcook.c texture.c cook.c -I../include -o texcook -lm
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "texture.h"
+#include "cook.h"
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv)
+{
+    const char* defaults[] = {"../res/back.png", "../res/fighter_texture.jpg", "../res/Ship_texture.png"};
+    const char** paths = argc > 1 ? (const char**)argv + 1 : defaults;
+    int count = argc > 1 ? argc - 1 : (int)(sizeof(defaults) / sizeof(defaults[0]));
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        const void* src;
+        size_t srcSize;
+        if (mapFile(paths[i], &src, &srcSize) != 0) {
+            printf("Failed to open texture: %s\n", paths[i]);
+            failed = 1;
+            continue;
+        }
+        double t0 = now();
+        uint64_t hash = hashContent(src, srcSize);
+        char cooked[64], cachePath[600];
+        cookName(cooked, sizeof(cooked), textureCookKey(hash), TEXCACHE_EXT);
+        const char* slash = strrchr(paths[i], '/');
+        int dirLength = slash ? (int)(slash - paths[i] + 1) : 0;
+        snprintf(cachePath, sizeof(cachePath), "%.*s%s", dirLength, paths[i], cooked);
+
+        TexCacheView view;
+        int upToDate = mapTextureCache(cachePath, hash, srcSize, &view);
+        if (!upToDate && (cookTexture(src, srcSize, hash, cachePath) != 0 || !mapTextureCache(cachePath, hash, srcSize, &view))) {
+            printf("Failed to cook texture: %s\n", paths[i]);
+            unmapFile(src, srcSize);
+            failed = 1;
+            continue;
+        }
+        double t = now() - t0;
+        unmapFile(src, srcSize);
+        const TexCacheHeader* h = view.header;
+        double raw = h->width * (double)h->height * 4.0 * 4.0 / 3.0; // RGBA8 с мипами
+        double size = view.mapSize - sizeof(TexCacheHeader);
+        printf("%s -> %s: %ux%u %s, %u mips, %.2f MB (RGBA8 %.2f MB, %.1fx), %s %.0f ms\n", paths[i], cooked, h->width,
+               h->height, h->format == TEXTURE_FORMAT_BC3 ? "BC3" : "BC1", h->numMips, size / (1024.0 * 1024.0),
+               raw / (1024.0 * 1024.0), raw / size, upToDate ? "up to date," : "cooked in", t * 1e3);
+        unmapTextureCache(&view);
+    }
+    return failed;
+}
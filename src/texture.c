@@ -0,0 +1,428 @@
+#include "texture.h"
+#include "cook.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "stb_image.h"
+
+_Static_assert(sizeof(TexCacheHeader) == 104, "TexCacheHeader layout is part of the .g3dt format");
+
+unsigned int textureMipCount(unsigned int width, unsigned int height)
+{
+    unsigned int count = 1;
+    while (width > 1 || height > 1) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        count++;
+    }
+    return count;
+}
+
+size_t compressedMipSize(unsigned int format, unsigned int width, unsigned int height)
+{
+    size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+    return blocks * (format == TEXTURE_FORMAT_BC3 ? 16 : 8);
+}
+
+static uint16_t packRgb565(const float* c)
+{
+    int r = (int)(c[0] * (31.0f / 255.0f) + 0.5f);
+    int g = (int)(c[1] * (63.0f / 255.0f) + 0.5f);
+    int b = (int)(c[2] * (31.0f / 255.0f) + 0.5f);
+    r = r < 0 ? 0 : (r > 31 ? 31 : r);
+    g = g < 0 ? 0 : (g > 63 ? 63 : g);
+    b = b < 0 ? 0 : (b > 31 ? 31 : b);
+    return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+static void unpackRgb565(uint16_t v, float* c)
+{
+    int r = v >> 11, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (float)(r << 3 | r >> 2);
+    c[1] = (float)(g << 2 | g >> 4);
+    c[2] = (float)(b << 3 | b >> 2);
+}
+
+// Индексы 4-цветного режима для пары концов; возвращает суммарную квадратичную ошибку
+static float pickColorIndices(const unsigned char* rgba, uint16_t c0, uint16_t c1, uint32_t* indices)
+{
+    float palette[4][3];
+    unpackRgb565(c0, palette[0]);
+    unpackRgb565(c1, palette[1]);
+    for (int k = 0; k < 3; k++) {
+        palette[2][k] = (2.0f * palette[0][k] + palette[1][k]) / 3.0f;
+        palette[3][k] = (palette[0][k] + 2.0f * palette[1][k]) / 3.0f;
+    }
+    float total = 0.0f;
+    *indices = 0;
+    for (int i = 0; i < 16; i++) {
+        const unsigned char* p = rgba + i * 4;
+        float best = INFINITY;
+        uint32_t bestIndex = 0;
+        for (uint32_t j = 0; j < (c0 == c1 ? 1u : 4u); j++) { // Равные концы - 3-цветный режим, индекс 3 был бы черным
+            float dr = p[0] - palette[j][0], dg = p[1] - palette[j][1], db = p[2] - palette[j][2];
+            float e = dr * dr + dg * dg + db * db;
+            if (e < best) {
+                best = e;
+                bestIndex = j;
+            }
+        }
+        *indices |= bestIndex << (i * 2);
+        total += best;
+    }
+    return total;
+}
+
+// Концы по главной оси цветов блока, затем одно уточнение методом наименьших квадратов
+void compressBlockBC1(const unsigned char* rgba, unsigned char* out)
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++)
+        for (int k = 0; k < 3; k++)
+            mean[k] += rgba[i * 4 + k] / 16.0f;
+    float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++) {
+        float d[3] = {rgba[i * 4] - mean[0], rgba[i * 4 + 1] - mean[1], rgba[i * 4 + 2] - mean[2]};
+        cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+        cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+    }
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iter = 0; iter < 8; iter++) { // Степенной метод
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float len = sqrtf(x * x + y * y + z * z);
+        if (len < 1e-6f)
+            break;
+        axis[0] = x / len;
+        axis[1] = y / len;
+        axis[2] = z / len;
+    }
+    float tmin = INFINITY, tmax = -INFINITY;
+    for (int i = 0; i < 16; i++) {
+        float t = (rgba[i * 4] - mean[0]) * axis[0] + (rgba[i * 4 + 1] - mean[1]) * axis[1] +
+                  (rgba[i * 4 + 2] - mean[2]) * axis[2];
+        tmin = t < tmin ? t : tmin;
+        tmax = t > tmax ? t : tmax;
+    }
+    float inset = (tmax - tmin) / 16.0f; // Концы чуть внутрь, чтобы промежуточные цвета ложились ближе к данным
+    float e0[3], e1[3];
+    for (int k = 0; k < 3; k++) {
+        e0[k] = mean[k] + axis[k] * (tmax - inset);
+        e1[k] = mean[k] + axis[k] * (tmin + inset);
+    }
+    uint16_t c0 = packRgb565(e0), c1 = packRgb565(e1);
+    if (c0 < c1) {
+        uint16_t t = c0;
+        c0 = c1;
+        c1 = t;
+    }
+    uint32_t indices;
+    float error = pickColorIndices(rgba, c0, c1, &indices);
+
+    // Наименьшие квадраты: пиксель = w * e0 + (1 - w) * e1 при весах индексов 1, 0, 2/3, 1/3
+    static const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[3] = {0.0f, 0.0f, 0.0f}, bx[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++) {
+        float a = weights[(indices >> (i * 2)) & 3], b = 1.0f - a;
+        aa += a * a;
+        bb += b * b;
+        ab += a * b;
+        for (int k = 0; k < 3; k++) {
+            ax[k] += a * rgba[i * 4 + k];
+            bx[k] += b * rgba[i * 4 + k];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (c0 != c1 && fabsf(det) > 1e-6f) {
+        for (int k = 0; k < 3; k++) {
+            e0[k] = (ax[k] * bb - bx[k] * ab) / det;
+            e1[k] = (bx[k] * aa - ax[k] * ab) / det;
+        }
+        uint16_t r0 = packRgb565(e0), r1 = packRgb565(e1);
+        if (r0 < r1) {
+            uint16_t t = r0;
+            r0 = r1;
+            r1 = t;
+        }
+        uint32_t refined;
+        float refinedError = pickColorIndices(rgba, r0, r1, &refined);
+        if (refinedError < error) {
+            c0 = r0;
+            c1 = r1;
+            indices = refined;
+        }
+    }
+    out[0] = c0 & 0xFF;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF;
+    out[3] = c1 >> 8;
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+// Альфа-блок: концы - минимум и максимум, 8-уровневый режим (a0 > a1)
+static void compressAlphaBlock(const unsigned char* rgba, unsigned char* out)
+{
+    int amin = 255, amax = 0;
+    for (int i = 0; i < 16; i++) {
+        int a = rgba[i * 4 + 3];
+        amin = a < amin ? a : amin;
+        amax = a > amax ? a : amax;
+    }
+    out[0] = (unsigned char)amax;
+    out[1] = (unsigned char)amin;
+    uint64_t bits = 0;
+    if (amax != amin) {
+        int palette[8];
+        palette[0] = amax;
+        palette[1] = amin;
+        for (int j = 2; j < 8; j++)
+            palette[j] = ((8 - j) * amax + (j - 1) * amin) / 7;
+        for (int i = 0; i < 16; i++) {
+            int a = rgba[i * 4 + 3], best = 256;
+            uint64_t bestIndex = 0;
+            for (int j = 0; j < 8; j++) {
+                int e = abs(a - palette[j]);
+                if (e < best) {
+                    best = e;
+                    bestIndex = (uint64_t)j;
+                }
+            }
+            bits |= bestIndex << (i * 3);
+        }
+    }
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (bits >> (i * 8)) & 0xFF;
+}
+
+void compressBlockBC3(const unsigned char* rgba, unsigned char* out)
+{
+    compressAlphaBlock(rgba, out);
+    compressBlockBC1(rgba, out + 8);
+}
+
+void downsampleImage(const unsigned char* src, unsigned int w, unsigned int h, unsigned int channels, unsigned char* dst)
+{
+    unsigned int dw = w > 1 ? w / 2 : 1, dh = h > 1 ? h / 2 : 1;
+    for (unsigned int y = 0; y < dh; y++) {
+        unsigned int y0 = y * 2 < h ? y * 2 : h - 1, y1 = y * 2 + 1 < h ? y * 2 + 1 : h - 1;
+        for (unsigned int x = 0; x < dw; x++) {
+            unsigned int x0 = x * 2 < w ? x * 2 : w - 1, x1 = x * 2 + 1 < w ? x * 2 + 1 : w - 1;
+            for (unsigned int k = 0; k < channels; k++) {
+                unsigned int sum = src[((size_t)y0 * w + x0) * channels + k] + src[((size_t)y0 * w + x1) * channels + k] +
+                                   src[((size_t)y1 * w + x0) * channels + k] + src[((size_t)y1 * w + x1) * channels + k];
+                dst[((size_t)y * dw + x) * channels + k] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+size_t textureChainSize(unsigned int width, unsigned int height, unsigned int bytesPerPixel)
+{
+    size_t total = 0;
+    for (;;) {
+        total += (size_t)width * height * bytesPerPixel;
+        if (width == 1 && height == 1)
+            return total;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+}
+
+static void compressLevel(const unsigned char* rgba, unsigned int w, unsigned int h, unsigned int format, unsigned char* out)
+{
+    size_t blockBytes = format == TEXTURE_FORMAT_BC3 ? 16 : 8;
+    unsigned char block[64];
+    for (unsigned int by = 0; by < h; by += 4) {
+        for (unsigned int bx = 0; bx < w; bx += 4) {
+            for (unsigned int y = 0; y < 4; y++) { // Блоки за краем заполняются краевыми пикселями
+                unsigned int sy = by + y < h ? by + y : h - 1;
+                for (unsigned int x = 0; x < 4; x++) {
+                    unsigned int sx = bx + x < w ? bx + x : w - 1;
+                    memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * w + sx) * 4, 4);
+                }
+            }
+            if (format == TEXTURE_FORMAT_BC3)
+                compressBlockBC3(block, out);
+            else
+                compressBlockBC1(block, out);
+            out += blockBytes;
+        }
+    }
+}
+
+static void fillTexCacheHeader(TexCacheHeader* h, uint64_t srcHash, uint64_t srcSize)
+{
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, TEXCACHE_MAGIC, 4);
+    h->version = TEXCACHE_VERSION;
+    h->srcHash = srcHash;
+    h->srcSize = srcSize;
+}
+
+uint64_t textureCookKey(uint64_t srcHash)
+{
+    uint32_t version = TEXCACHE_VERSION;
+    return cookKey(srcHash, &version, sizeof(version));
+}
+
+int cookTexture(const void* src, size_t srcSize, uint64_t srcHash, const char* cachePath)
+{
+    int width, height, channels;
+    unsigned char* level = srcSize <= INT_MAX ? stbi_load_from_memory(src, (int)srcSize, &width, &height, &channels, 4) : NULL;
+    if (!level) {
+        printf("Failed to load texture: %s\n", stbi_failure_reason());
+        return -1;
+    }
+
+    // BC3 только если альфа действительно используется
+    unsigned int format = TEXTURE_FORMAT_BC1;
+    if (channels == 2 || channels == 4) {
+        for (size_t i = 0; i < (size_t)width * height; i++) {
+            if (level[i * 4 + 3] != 255) {
+                format = TEXTURE_FORMAT_BC3;
+                break;
+            }
+        }
+    }
+
+    TexCacheHeader h;
+    fillTexCacheHeader(&h, srcHash, srcSize);
+    h.width = width;
+    h.height = height;
+    h.format = format;
+    h.numMips = textureMipCount(width, height);
+    if (h.numMips > TEXCACHE_MAX_MIPS) {
+        printf("Texture too large to cook: %s\n", cachePath);
+        stbi_image_free(level);
+        return -1;
+    }
+    size_t total = 0;
+    unsigned int w = width, hgt = height;
+    for (unsigned int l = 0; l < h.numMips; l++) {
+        h.mipSize[l] = (uint32_t)compressedMipSize(format, w, hgt);
+        total += h.mipSize[l];
+        w = w > 1 ? w / 2 : 1;
+        hgt = hgt > 1 ? hgt / 2 : 1;
+    }
+
+    unsigned char* blocks = malloc(total);
+    unsigned char* next = malloc((size_t)(width > 1 ? width / 2 : 1) * (height > 1 ? height / 2 : 1) * 4);
+    if (!blocks || !next) {
+        printf("Out of memory while cooking texture: %s\n", cachePath);
+        free(blocks);
+        free(next);
+        stbi_image_free(level);
+        return -1;
+    }
+    size_t offset = 0;
+    w = width;
+    hgt = height;
+    unsigned char* current = level;
+    unsigned char* scratch = next;
+    for (unsigned int l = 0; l < h.numMips; l++) {
+        compressLevel(current, w, hgt, format, blocks + offset);
+        offset += h.mipSize[l];
+        if (l + 1 < h.numMips) { // Каждый уровень из предыдущего, буферы меняются местами
+            downsampleImage(current, w, hgt, 4, scratch);
+            unsigned char* t = current;
+            current = scratch;
+            scratch = t;
+            w = w > 1 ? w / 2 : 1;
+            hgt = hgt > 1 ? hgt / 2 : 1;
+        }
+    }
+    stbi_image_free(level);
+    free(next);
+
+    char tmpPath[520];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", cachePath);
+    FILE* file = makeParentDir(cachePath) == 0 ? fopen(tmpPath, "wb") : NULL;
+    int ok = file && fwrite(&h, sizeof(h), 1, file) == 1 && fwrite(blocks, 1, total, file) == total;
+    if (file)
+        ok = (fclose(file) == 0) && ok;
+    free(blocks);
+    if (!ok || rename(tmpPath, cachePath) != 0) {
+        printf("Failed to write texture cache: %s\n", cachePath);
+        remove(tmpPath);
+        return -1;
+    }
+    return 0;
+}
+
+// Проверка кеша в памяти против ожидаемого исходника и целостности размеров мипов
+static int validTextureCache(const void* data, size_t size, const TexCacheHeader* expect, TexCacheView* view)
+{
+    const TexCacheHeader* h = data;
+    if (size < sizeof(TexCacheHeader))
+        return 0;
+    int ok = memcmp(h->magic, expect->magic, 4) == 0 && h->version == expect->version &&
+             (h->format == TEXTURE_FORMAT_BC1 || h->format == TEXTURE_FORMAT_BC3) &&
+             h->width > 0 && h->height > 0 && h->numMips == textureMipCount(h->width, h->height) &&
+             h->numMips <= TEXCACHE_MAX_MIPS &&
+             h->srcHash == expect->srcHash && h->srcSize == expect->srcSize;
+    size_t total = 0;
+    unsigned int w = h->width, hgt = h->height;
+    for (unsigned int l = 0; ok && l < h->numMips; l++) {
+        ok = h->mipSize[l] == compressedMipSize(h->format, w, hgt);
+        total += h->mipSize[l];
+        w = w > 1 ? w / 2 : 1;
+        hgt = hgt > 1 ? hgt / 2 : 1;
+    }
+    if (!ok || size != sizeof(TexCacheHeader) + total)
+        return 0;
+    view->header = h;
+    view->data = (const unsigned char*)(h + 1);
+    return 1;
+}
+
+int mapTextureCache(const char* cachePath, uint64_t srcHash, uint64_t srcSize, TexCacheView* view)
+{
+    memset(view, 0, sizeof(*view));
+    int fd = open(cachePath, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat cst;
+    if (fstat(fd, &cst) != 0 || (size_t)cst.st_size < sizeof(TexCacheHeader)) {
+        close(fd);
+        return 0;
+    }
+    void* map = mmap(NULL, cst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return 0;
+
+    TexCacheHeader expect;
+    fillTexCacheHeader(&expect, srcHash, srcSize);
+    if (!validTextureCache(map, cst.st_size, &expect, view)) {
+        munmap(map, cst.st_size);
+        return 0;
+    }
+    view->map = map;
+    view->mapSize = cst.st_size;
+    return 1;
+}
+
+int viewTextureCache(const void* data, size_t size, uint64_t srcHash, uint64_t srcSize, TexCacheView* view)
+{
+    memset(view, 0, sizeof(*view));
+    TexCacheHeader expect;
+    fillTexCacheHeader(&expect, srcHash, srcSize);
+    return validTextureCache(data, size, &expect, view);
+}
+
+void unmapTextureCache(TexCacheView* view)
+{
+    if (view->map)
+        munmap(view->map, view->mapSize);
+    memset(view, 0, sizeof(*view));
+}
@@ -0,0 +1,56 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TEXTURE_FORMAT_BC1 1 // 8 байт на блок 4x4, цвет без альфы
+#define TEXTURE_FORMAT_BC3 2 // 16 байт на блок: 8 байт альфы + блок BC1
+
+#define TEXCACHE_MAGIC "G3DT"
+#define TEXCACHE_VERSION 2
+#define TEXCACHE_EXT ".g3dt"
+#define TEXCACHE_MAX_MIPS 16 // До 32768x32768
+
+typedef struct { // Заголовок сжатой текстуры (.g3dt), за ним мип-уровни от большего к меньшему
+    char magic[4];
+    uint32_t version;
+    uint64_t srcHash; // Хеш содержимого и размер исходного изображения (hashContent)
+    uint64_t srcSize;
+    uint32_t width, height;
+    uint32_t format; // TEXTURE_FORMAT_*
+    uint32_t numMips;
+    uint32_t mipSize[TEXCACHE_MAX_MIPS]; // Байт на уровень
+} TexCacheHeader;
+
+typedef struct { // Отображенный в память кеш; data указывает на первый мип-уровень
+    void* map;
+    size_t mapSize;
+    const TexCacheHeader* header;
+    const unsigned char* data;
+} TexCacheView;
+
+// Полная цепочка мипов до 1x1
+unsigned int textureMipCount(unsigned int width, unsigned int height);
+size_t compressedMipSize(unsigned int format, unsigned int width, unsigned int height);
+
+// Байт на несжатую текстуру со всеми мипами
+size_t textureChainSize(unsigned int width, unsigned int height, unsigned int bytesPerPixel);
+// Уменьшение вдвое усреднением 2x2, у нечетного края последний столбец/строка повторяется
+void downsampleImage(const unsigned char* src, unsigned int w, unsigned int h, unsigned int channels, unsigned char* dst);
+
+// Сжатие одного блока 4x4 (rgba - 16 пикселей RGBA8 построчно)
+void compressBlockBC1(const unsigned char* rgba, unsigned char* out);
+void compressBlockBC3(const unsigned char* rgba, unsigned char* out);
+
+// Ключ готовой текстуры: содержимое исходника и версия кеша
+uint64_t textureCookKey(uint64_t srcHash);
+// Декодирование изображения из памяти, построение мипов и сжатие в cachePath. 0 при успехе
+int cookTexture(const void* src, size_t srcSize, uint64_t srcHash, const char* cachePath);
+// 1 - кеш cachePath найден и собран из этого исходника
+int mapTextureCache(const char* cachePath, uint64_t srcHash, uint64_t srcSize, TexCacheView* view);
+// То же для кеша, уже лежащего в памяти (запись архива). view->map = NULL
+int viewTextureCache(const void* data, size_t size, uint64_t srcHash, uint64_t srcSize, TexCacheView* view);
+void unmapTextureCache(TexCacheView* view);
+
+#endif
@@ -0,0 +1,166 @@
+#include "upload.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int pump(Uploader* u, size_t budget, int wait);
+static int flush(Uploader* u, int untilCount);
+
+void uploaderInit(Uploader* u)
+{
+    memset(u, 0, sizeof(*u));
+    glGenBuffers(UPLOAD_STAGING_BUFFERS, u->pbo);
+    for (int i = 0; i < UPLOAD_STAGING_BUFFERS; i++) { // Память PBO - один раз; map с INVALIDATE сам ее отвязывает
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, u->pbo[i]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, UPLOAD_STAGING_SIZE, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void uploaderQueue(Uploader* u, const UploadJob* job)
+{
+    if (u->count == UPLOAD_MAX_JOBS && flush(u, UPLOAD_MAX_JOBS - 1) != 0) {
+        if (job->release) // Задача не встанет в очередь: данные больше не нужны
+            job->release(job->ctx);
+        return;
+    }
+    u->jobs[(u->head + u->count) % UPLOAD_MAX_JOBS] = *job;
+    u->count++;
+}
+
+// Свободный PBO или -1, если следующий в кольце еще читается GPU (wait = 0)
+static int acquireStaging(Uploader* u, int wait)
+{
+    int i = u->nextPbo;
+    if (u->fence[i]) {
+        GLenum r = glClientWaitSync(u->fence[i], GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000ull : 0);
+        if (r == GL_TIMEOUT_EXPIRED) { // GL_WAIT_FAILED - fence уже недействителен, буфер свободен
+            u->busySkips++;
+            return -1;
+        }
+        glDeleteSync(u->fence[i]);
+        u->fence[i] = 0;
+    }
+    u->nextPbo = (i + 1) % UPLOAD_STAGING_BUFFERS;
+    return i;
+}
+
+static void finishJob(UploadJob* job)
+{
+    if (job->level >= 0 && job->baseLevel != UPLOAD_KEEP_BASE) {
+        glBindTexture(GL_TEXTURE_2D, job->object);
+        if (job->baseLevel == UPLOAD_GENERATE_MIPS)
+            glGenerateMipmap(GL_TEXTURE_2D);
+        else
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job->baseLevel);
+    }
+    if (job->release)
+        job->release(job->ctx);
+}
+
+static int pump(Uploader* u, size_t budget, int wait)
+{
+    size_t sent = 0;
+    while (u->count > 0 && sent < budget) {
+        UploadJob* job = &u->jobs[u->head];
+        if (job->size == 0) {
+            finishJob(job);
+            u->head = (u->head + 1) % UPLOAD_MAX_JOBS;
+            u->count--;
+            continue;
+        }
+        size_t n = job->size - job->done;
+        size_t limit = budget - sent < UPLOAD_STAGING_SIZE ? budget - sent : UPLOAD_STAGING_SIZE;
+        if (n > limit) {
+            // Куски текстуры - целыми строками (строками блоков у сжатых)
+            n = job->level >= 0 ? limit / job->rowBytes * job->rowBytes : limit;
+            if (n == 0)
+                n = job->rowBytes < UPLOAD_STAGING_SIZE ? job->rowBytes : UPLOAD_STAGING_SIZE;
+            if (n > budget - sent && sent > 0)
+                break; // Строка не влезает в остаток бюджета кадра
+        }
+        int i = acquireStaging(u, wait);
+        if (i < 0)
+            break;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, u->pbo[i]);
+        void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, n, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!dst) { // Кусок не отправлен: задача остается в очереди, повтор - в следующий раз
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            u->mapFailures++;
+            break;
+        }
+        memcpy(dst, job->data + job->done, n);
+        if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) { // Содержимое PBO потеряно - тоже повтор
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            u->mapFailures++;
+            break;
+        }
+        if (job->level < 0) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glBindBuffer(GL_COPY_READ_BUFFER, u->pbo[i]);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, job->object);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, job->done, n);
+        } else {
+            unsigned int y = (unsigned int)(job->done / job->rowBytes) * job->rowHeight;
+            unsigned int rows = (unsigned int)(n / job->rowBytes) * job->rowHeight;
+            if (y + rows > job->height)
+                rows = job->height - y; // Последняя строка блоков у края уровня
+            glBindTexture(GL_TEXTURE_2D, job->object);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            if (job->compressed)
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, job->level, 0, y, job->width, rows, job->format, n, (void*)0);
+            else
+                glTexSubImage2D(GL_TEXTURE_2D, job->level, 0, y, job->width, rows, job->format, GL_UNSIGNED_BYTE, (void*)0);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        u->fence[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        job->done += n;
+        sent += n;
+        u->totalBytes += n;
+        if (job->done == job->size) {
+            finishJob(job);
+            u->head = (u->head + 1) % UPLOAD_MAX_JOBS;
+            u->count--;
+        }
+    }
+    return u->count;
+}
+
+int uploaderPump(Uploader* u, size_t budget)
+{
+    return pump(u, budget, 0);
+}
+
+// Досылает, пока в очереди больше untilCount задач; -1, если досылка стоит (map не удается)
+static int flush(Uploader* u, int untilCount)
+{
+    int stalls = 0;
+    while (u->count > untilCount) {
+        size_t before = u->totalBytes;
+        int count = u->count;
+        pump(u, (size_t)-1, 1);
+        stalls = u->totalBytes == before && u->count == count ? stalls + 1 : 0;
+        if (stalls == UPLOAD_FLUSH_RETRIES) {
+            printf("Failed to upload: %d jobs left, PBO map failed %u times\n", u->count, u->mapFailures);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void uploaderFlush(Uploader* u)
+{
+    flush(u, 0);
+}
+
+void uploaderDestroy(Uploader* u)
+{
+    uploaderFlush(u);
+    for (int i = 0; i < UPLOAD_STAGING_BUFFERS; i++)
+        if (u->fence[i])
+            glDeleteSync(u->fence[i]);
+    glDeleteBuffers(UPLOAD_STAGING_BUFFERS, u->pbo);
+    memset(u, 0, sizeof(*u));
+}
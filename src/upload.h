@@ -0,0 +1,52 @@
+#ifndef UPLOAD_H
+#define UPLOAD_H
+
+#include <stddef.h>
+#include <glad/glad.h>
+
+#define UPLOAD_STAGING_BUFFERS 4               // PBO в кольце, каждый со своим fence
+#define UPLOAD_STAGING_SIZE (1u * 1024 * 1024) // Байт на один PBO
+#define UPLOAD_MAX_JOBS 64
+#define UPLOAD_FLUSH_RETRIES 16 // Попыток подряд без продвижения, после которых досылка сдается
+
+#define UPLOAD_KEEP_BASE -1     // После уровня базовый уровень не меняется
+#define UPLOAD_GENERATE_MIPS -2 // После уровня 0 - glGenerateMipmap
+
+typedef struct {
+    unsigned int object; // Текстура GL_TEXTURE_2D или буфер
+    int level;           // Мип-уровень; -1 - буфер (VBO/EBO), копия через GL_COPY_WRITE_BUFFER
+    unsigned int format; // Внутренний формат сжатой текстуры или формат пикселей (GL_RGB...)
+    int compressed;
+    unsigned int width, height;
+    size_t rowBytes;        // Строка копирования: строка пикселей или строка блоков 4x4
+    unsigned int rowHeight; // 1 или 4 (сжатые)
+    const unsigned char* data;
+    size_t size, done;
+    int baseLevel; // После последнего куска: GL_TEXTURE_BASE_LEVEL или UPLOAD_*
+    void (*release)(void* ctx); // После последнего куска, когда данные уже скопированы в PBO
+    void* ctx;
+} UploadJob;
+
+// Потоковая загрузка через кольцо PBO: за кадр копируется не больше бюджета байт,
+// занятый GPU буфер пропускается до следующего кадра вместо ожидания
+typedef struct {
+    unsigned int pbo[UPLOAD_STAGING_BUFFERS];
+    GLsync fence[UPLOAD_STAGING_BUFFERS];
+    int nextPbo;
+    UploadJob jobs[UPLOAD_MAX_JOBS]; // Очередь FIFO
+    int head, count;
+    size_t totalBytes;
+    unsigned int busySkips;   // Сколько раз PBO был еще занят GPU
+    unsigned int mapFailures; // Сколько раз не удалось отобразить PBO (кусок повторяется)
+} Uploader;
+
+void uploaderInit(Uploader* u);
+// Копирует данные задачи; при переполнении очереди сначала досылает накопленное
+void uploaderQueue(Uploader* u, const UploadJob* job);
+// Один кадр: до budget байт. Возвращает число оставшихся задач
+int uploaderPump(Uploader* u, size_t budget);
+// Досылает все (с ожиданием GPU); если отобразить PBO не удается раз за разом - сдается с ошибкой
+void uploaderFlush(Uploader* u);
+void uploaderDestroy(Uploader* u);
+
+#endif
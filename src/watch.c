@@ -0,0 +1,65 @@
+#include "watch.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+int watchInit(Watcher* w)
+{
+    memset(w, 0, sizeof(*w));
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->fd < 0) {
+        printf("Failed to start file watcher\n");
+        return -1;
+    }
+    return 0;
+}
+
+int watchAdd(Watcher* w, const char* dir, const char* prefix)
+{
+    if (w->fd < 0 || w->numDirs == WATCH_MAX_DIRS || strlen(prefix) >= sizeof(w->prefix[0]))
+        return -1;
+    // Редакторы обычно пишут во временный файл и переименовывают его, поэтому нужен и IN_MOVED_TO
+    int wd = inotify_add_watch(w->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+        printf("Failed to watch directory: %s\n", dir);
+        return -1;
+    }
+    w->wd[w->numDirs] = wd;
+    strcpy(w->prefix[w->numDirs], prefix);
+    w->numDirs++;
+    return 0;
+}
+
+int watchNext(Watcher* w, char* name, size_t size)
+{
+    if (w->fd < 0)
+        return 0;
+    for (;;) {
+        if (w->offset >= w->length) {
+            ssize_t n = read(w->fd, w->buffer, sizeof(w->buffer));
+            if (n <= 0)
+                return 0; // EAGAIN - событий нет
+            w->length = (size_t)n;
+            w->offset = 0;
+        }
+        const struct inotify_event* e = (const struct inotify_event*)(w->buffer + w->offset);
+        w->offset += sizeof(struct inotify_event) + e->len;
+        if (e->len == 0 || (e->mask & IN_ISDIR))
+            continue;
+        for (int i = 0; i < w->numDirs; i++) {
+            if (w->wd[i] == e->wd) {
+                snprintf(name, size, "%s%s", w->prefix[i], e->name);
+                return 1;
+            }
+        }
+    }
+}
+
+void watchClose(Watcher* w)
+{
+    if (w->fd >= 0)
+        close(w->fd);
+    w->fd = -1;
+}
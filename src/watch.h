@@ -0,0 +1,27 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stddef.h>
+
+#define WATCH_MAX_DIRS 8
+#define WATCH_BUFFER_SIZE 4096
+
+// Слежение за изменением файлов в каталогах (inotify), без ожидания: опрашивается раз в кадр
+typedef struct {
+    int fd; // -1 - слежение недоступно
+    int wd[WATCH_MAX_DIRS];
+    char prefix[WATCH_MAX_DIRS][64]; // Добавляется к имени файла из каталога ("shaders/")
+    int numDirs;
+    char buffer[WATCH_BUFFER_SIZE] __attribute__((aligned(8)));
+    size_t length, offset; // Прочитанные и разобранные байты событий
+} Watcher;
+
+// 0 при успехе
+int watchInit(Watcher* w);
+// Файлы dir будут сообщаться как prefix + имя. 0 при успехе
+int watchAdd(Watcher* w, const char* dir, const char* prefix);
+// Следующий записанный или перемещенный в каталог файл; 0 - новых изменений нет
+int watchNext(Watcher* w, char* name, size_t size);
+void watchClose(Watcher* w);
+
+#endif